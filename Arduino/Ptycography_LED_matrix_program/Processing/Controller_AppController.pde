@@ -102,6 +102,28 @@ class AppController extends EventDispatcher implements SerialEventCallback {
     cameraModel.setPulseWidth(cameraConfig.getInt("pulseWidth", 100));
     cameraModel.setPostDelay(cameraConfig.getInt("postDelay", 1500));
     
+    if (cameraConfig.hasKey("bracketPulseWidths")) {
+      JSONArray bracket = cameraConfig.getJSONArray("bracketPulseWidths");
+      int[] widths = new int[bracket.size()];
+      for (int i = 0; i < widths.length; i++) {
+        widths[i] = bracket.getInt(i);
+      }
+      cameraModel.setBracketPulseWidths(widths);
+    }
+    cameraModel.setVideoMode(cameraConfig.getBoolean("videoMode", false));
+    
+    if (cameraConfig.hasKey("secondaryCameras")) {
+      JSONArray secondary = cameraConfig.getJSONArray("secondaryCameras");
+      for (int i = 0; i < secondary.size() && i + 1 < CameraModel.NUM_CAMERAS; i++) {
+        JSONObject profile = secondary.getJSONObject(i);
+        cameraModel.setCameraProfile(i + 1,
+                                     profile.getBoolean("enabled", false),
+                                     profile.getInt("preDelay", 400),
+                                     profile.getInt("pulseWidth", 100),
+                                     profile.getInt("postDelay", 1500));
+      }
+    }
+    
     // Apply simulation mode setting
     stateModel.setSimulationMode(config.getSimulationMode());
   }
@@ -154,6 +176,18 @@ class AppController extends EventDispatcher implements SerialEventCallback {
         // Refresh port list
         serialManager.refreshPortList();
         break;
+        
+      case 'v':
+      case 'V':
+        // Toggle camera-as-master video mode
+        setVideoMode(!cameraModel.isVideoMode());
+        break;
+        
+      case 'k':
+      case 'K':
+        // Run LED brightness calibration sweep
+        startCalibration();
+        break;
     }
   }
   
@@ -198,6 +232,21 @@ class AppController extends EventDispatcher implements SerialEventCallback {
     }
   }
   
+  /**
+   * Start an LED brightness calibration sweep
+   * Runs the sequence once over a blank slide; the frames are processed
+   * on the reconstruction side into a per-LED brightness profile.
+   */
+  public void startCalibration() {
+    if (stateModel.isSimulationMode() || !serialManager.isConnected()) {
+      println("Cannot calibrate: Hardware not connected");
+      return;
+    }
+    
+    stateModel.startSequence();
+    serialManager.startCalibration();
+  }
+  
   /**
    * Stop sequence
    */
@@ -286,9 +335,25 @@ class AppController extends EventDispatcher implements SerialEventCallback {
     cameraModel.setPulseWidth(pulseWidth);
     cameraModel.setPostDelay(postDelay);
     
-    // Send to hardware if connected
+    // Send to hardware if connected, the full camera state through the one path
+    if (!stateModel.isSimulationMode() && serialManager.isConnected()) {
+      serialManager.sendCameraSettings();
+    }
+  }
+  
+  /**
+   * Switch between firmware-timed stills and camera-as-master video mode
+   */
+  public void setVideoMode(boolean videoMode) {
+    if (stateModel.isRunning()) {
+      println("Cannot change acquisition mode while a sequence is running");
+      return;
+    }
+    
+    cameraModel.setVideoMode(videoMode);
+    
     if (!stateModel.isSimulationMode() && serialManager.isConnected()) {
-      serialManager.sendCommand(cameraModel.getSettingsCommand(SerialManager.CMD_SET_CAMERA));
+      serialManager.sendCommand(cameraModel.getVideoModeCommand(SerialManager.CMD_VIDEO_MODE));
     }
   }
   
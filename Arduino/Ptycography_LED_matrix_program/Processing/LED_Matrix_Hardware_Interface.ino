@@ -36,23 +36,66 @@ const char CMD_ENTER_IDLE = 'i';       // Enter idle mode
 const char CMD_EXIT_IDLE = 'a';        // Exit idle mode
 const char CMD_SET_LED = 'L';          // Set specific LED
 const char CMD_SET_CAMERA = 'C';       // Set camera trigger settings
+const char CMD_CALIBRATE = 'K';        // Run a single calibration sweep
+const char CMD_VIDEO_MODE = 'V';       // Camera-as-master video mode (V1 = on, V0 = off)
 
 // Status variables
 boolean running = false;
 boolean idleMode = false;
+boolean calibrating = false;  // Single pass over the sequence, stops at the end
 int currentSequenceIndex = 0;
 int totalSequenceSteps = 0;
 
 // Camera parameters
-boolean cameraEnabled = true;
-int cameraPreDelay = 400;    // Delay in ms before triggering (for auto-exposure)
-int cameraPulseWidth = 100;  // Camera trigger pulse width in ms
-int cameraPostDelay = 1500;  // Delay in ms after triggering (for capture)
+boolean cameraEnabled = true;  // Master enable for all trigger outputs
 #define PIN_PHOTO_TRIGGER 5  // Pin used to trigger camera shutter
 
+// Multi-camera trigger fanout - every output has its own timing profile and
+// ready input, and all of them fire for each LED of a single pass.
+// Camera 0 is the measurement camera (CS command, exposure brackets).
+#define NUM_CAMERAS 2
+#define PIN_PHOTO_TRIGGER_2 6      // Trigger output for camera 1
+#define PIN_CAMERA_READY_1 7       // Ready input for camera 0 (HIGH = ready, pulled up when unconnected)
+#define PIN_CAMERA_READY_2 8       // Ready input for camera 1
+#define CAMERA_READY_TIMEOUT 5000  // ms to wait for a ready input before aborting the sequence
+const int cameraTriggerPin[NUM_CAMERAS] = {PIN_PHOTO_TRIGGER, PIN_PHOTO_TRIGGER_2};
+const int cameraReadyPin[NUM_CAMERAS] = {PIN_CAMERA_READY_1, PIN_CAMERA_READY_2};
+boolean cameraOutputEnabled[NUM_CAMERAS] = {true, false};
+int cameraPreDelay[NUM_CAMERAS] = {400, 400};     // Delay in ms before triggering (for auto-exposure)
+int cameraPulseWidth[NUM_CAMERAS] = {100, 100};   // Camera trigger pulse width in ms
+int cameraPostDelay[NUM_CAMERAS] = {1500, 1500};  // Delay in ms after triggering (for capture)
+
+// Non-blocking trigger scheduler, one state machine per camera
+#define CAM_IDLE 0
+#define CAM_WAIT_READY 1
+#define CAM_PRE_DELAY 2
+#define CAM_PULSE 3
+#define CAM_POST_DELAY 4
+byte cameraState[NUM_CAMERAS] = {CAM_IDLE, CAM_IDLE};
+unsigned long cameraPhaseStart[NUM_CAMERAS];
+int cameraShot[NUM_CAMERAS];   // Exposure index within the current LED
+boolean shotsPending = false;  // Cameras still busy with the current LED
+
+// Exposure bracketing - N triggers per LED, each with its own pulse width
+#define MAX_BRACKET_EXPOSURES 8
+int bracketCount = 1;        // Number of exposures per LED (1 = no bracketing)
+int bracketPulseWidth[MAX_BRACKET_EXPOSURES] = {100, 100, 100, 100, 100, 100, 100, 100};
+
+// Camera-as-master video mode - the camera records continuously and the
+// falling edge of its strobe/exposure-out signal advances the LED
+#define PIN_CAMERA_STROBE 2     // Camera strobe input (must support external interrupts)
+#define STROBE_QUEUE_SIZE 16    // Edges buffered between the ISR and loop()
+boolean videoMode = false;
+unsigned long videoMaxLatencyUs = 2000;  // LED switched later than this after an edge marks the frame late
+volatile unsigned long strobeCount = 0;
+volatile unsigned long strobeMicros[STROBE_QUEUE_SIZE];
+unsigned long strobeProcessed = 0;
+
 // Camera status tracking
 boolean cameraTriggerActive = false;
 int cameraErrorCode = 0;     // 0 = no error, error codes match CameraManager
+#define CAMERA_ERROR_TIMEOUT 1        // A camera's ready input stayed low
+#define CAMERA_ERROR_FRAME_OVERRUN 4  // Strobe edges arrived faster than they could be logged
 
 // Current LED state
 int currentLedX = -1;
@@ -99,7 +142,7 @@ int sequenceLength = 0;
 
 void setup() {
   // Initialize serial communication
-  Serial.begin(9600);
+  Serial.begin(115200);  // Video mode logs one line per frame
   
   // Configure LED matrix pins
   initializePins();
@@ -122,7 +165,11 @@ void loop() {
   
   // Update LED sequence if running
   if (running) {
-    updateSequence();
+    if (videoMode) {
+      updateVideoSequence();
+    } else {
+      updateSequence();
+    }
   }
   
   // Handle idle mode
@@ -152,9 +199,15 @@ void initializePins() {
   pinMode(PIN_LED_B0, OUTPUT);  // Blue - lower half
   pinMode(PIN_LED_B1, OUTPUT);  // Blue - upper half
   
-  // Camera control pin
-  pinMode(PIN_PHOTO_TRIGGER, OUTPUT);
-  digitalWrite(PIN_PHOTO_TRIGGER, LOW);
+  // Camera trigger outputs and ready inputs
+  for (int cam = 0; cam < NUM_CAMERAS; cam++) {
+    pinMode(cameraTriggerPin[cam], OUTPUT);
+    digitalWrite(cameraTriggerPin[cam], LOW);
+    pinMode(cameraReadyPin[cam], INPUT_PULLUP);
+  }
+  
+  // Camera strobe input for video mode
+  pinMode(PIN_CAMERA_STROBE, INPUT_PULLUP);
   
   // Set default states
   digitalWrite(PIN_LED_BL, HIGH);  // Blank display initially
@@ -215,12 +268,21 @@ void processSerialCommands() {
         
       case CMD_START_SEQUENCE:
         running = true;
+        calibrating = false;
         idleMode = false;
         currentSequenceIndex = 0;
+        if (videoMode) {
+          startVideoSequence();
+        }
         break;
         
       case CMD_STOP_SEQUENCE:
+        if (videoMode) {
+          detachInterrupt(digitalPinToInterrupt(PIN_CAMERA_STROBE));
+        }
         running = false;
+        calibrating = false;
+        abortCameraShots();
         currentSequenceIndex = 0;
         currentLedX = -1;
         currentLedY = -1;
@@ -230,6 +292,7 @@ void processSerialCommands() {
       case CMD_ENTER_IDLE:
         idleMode = true;
         running = false;
+        abortCameraShots();
         currentLedX = -1;
         currentLedY = -1;
         turnOffLeds();
@@ -241,6 +304,31 @@ void processSerialCommands() {
         turnOffLeds();
         break;
         
+      case CMD_VIDEO_MODE:
+        // Format: V<0|1>[,<maxLatencyUs>]
+        if (!running) {
+          videoMode = value.toInt() != 0;
+          if (value.indexOf(',') > 0 && value.substring(value.indexOf(',') + 1).toInt() > 0) {
+            videoMaxLatencyUs = value.substring(value.indexOf(',') + 1).toInt();
+          }
+          Serial.println(videoMode ? "Video mode enabled" : "Video mode disabled");
+        }
+        break;
+        
+      case CMD_CALIBRATE:
+        // Sweep every LED of the sequence exactly once (blank slide in place).
+        // The sweep is trigger driven, video mode has no strobe to follow here
+        if (videoMode) {
+          Serial.println("CALIBRATION,ERROR,video mode");
+          break;
+        }
+        running = true;
+        calibrating = true;
+        idleMode = false;
+        currentSequenceIndex = 0;
+        Serial.println("CALIBRATION,START");
+        break;
+        
       case CMD_SET_LED:
         // Format: L,x,y,color
         // Parse coordinates and color
@@ -262,12 +350,12 @@ void processSerialCommands() {
         
       case CMD_SET_CAMERA:
         // Format: C<type>,<param1>,<param2>,...
-        // Parse the command type (S = settings, T = test)
+        // Parse the command type (S = settings, T = test, B = bracket, M = multi-camera profile)
         if (value.length() > 0) {
           char type = value.charAt(0);
           
-          // Check for S or T commands and comma separator
-          if ((type == 'S' || type == 'T') && value.indexOf(',') > 0) {
+          // Check for S, T or B commands and comma separator
+          if ((type == 'S' || type == 'T' || type == 'B' || type == 'M') && value.indexOf(',') > 0) {
             // Extract the parameters
             value = value.substring(2);  // Skip type and comma
             
@@ -286,9 +374,9 @@ void processSerialCommands() {
                 
                 // Update camera settings
                 cameraEnabled = newEnabled;
-                cameraPreDelay = newPreDelay;
-                cameraPulseWidth = newPulseWidth;
-                cameraPostDelay = newPostDelay;
+                cameraPreDelay[0] = newPreDelay;
+                cameraPulseWidth[0] = newPulseWidth;
+                cameraPostDelay[0] = newPostDelay;
                 
                 Serial.println("Camera settings updated");
               }
@@ -313,6 +401,16 @@ void processSerialCommands() {
                 }
               }
             }
+            
+            // For B command - Bracket: B,<count>,<pulseWidth1>,...,<pulseWidthN>
+            else if (type == 'B') {
+              parseBracketSettings(value);
+            }
+            
+            // For M command - Camera profile: M,<camera>,<enabled>,<preDelay>,<pulseWidth>,<postDelay>
+            else if (type == 'M') {
+              parseCameraProfile(value);
+            }
           }
         }
         break;
@@ -465,6 +563,15 @@ void generateSequence() {
 }
 
 void updateSequence() {
+  // Wait until every camera is done with the current LED
+  if (shotsPending) {
+    if (!serviceCameras()) {
+      return;
+    }
+    shotsPending = false;
+    currentSequenceIndex++;
+  }
+  
   // Check if it's time to update
   unsigned long currentTime = millis();
   if (currentTime - lastUpdateTime < UPDATE_INTERVAL) {
@@ -475,6 +582,12 @@ void updateSequence() {
   
   // Check if we've reached the end of the sequence
   if (currentSequenceIndex >= sequenceLength) {
+    // A calibration sweep covers each LED once, then stops
+    if (calibrating) {
+      finishCalibration();
+      return;
+    }
+    
     // Loop back to the beginning
     currentSequenceIndex = 0;
   }
@@ -489,15 +602,134 @@ void updateSequence() {
   // Send update to Processing
   sendLedUpdate();
   
-  // Trigger camera if enabled
+  // Start the cameras; the index advances once all of them have finished
   if (cameraEnabled) {
-    triggerCamera();
+    startCameraShots();
+    if (shotsPending) {
+      return;
+    }
   }
   
   // Increment sequence index
   currentSequenceIndex++;
 }
 
+/**
+ * End a calibration sweep and report the number of frames taken
+ * Format: CALIBRATION,DONE,steps
+ */
+void finishCalibration() {
+  Serial.print("CALIBRATION,DONE,");
+  Serial.println(sequenceLength);
+  
+  running = false;
+  calibrating = false;
+  currentSequenceIndex = 0;
+  turnOffLeds();
+  sendLedUpdate();
+  sendStatus();
+}
+
+/**
+ * Strobe interrupt - records the edge only, loop() does the LED update
+ */
+void onCameraStrobe() {
+  strobeMicros[strobeCount % STROBE_QUEUE_SIZE] = micros();
+  strobeCount++;
+}
+
+/**
+ * Start a camera-as-master sequence
+ * 
+ * Frame 0 is lit by sequence step 0 as soon as the sequence starts. The
+ * falling strobe edge that ends frame n advances to step n + 1, so frame
+ * numbers and sequence steps stay identical for the whole run.
+ */
+void startVideoSequence() {
+  noInterrupts();
+  strobeCount = 0;
+  interrupts();
+  strobeProcessed = 0;
+  cameraErrorCode = 0;
+  
+  Serial.println("VIDEO,START");
+  showVideoFrame(0, micros(), false);
+  
+  attachInterrupt(digitalPinToInterrupt(PIN_CAMERA_STROBE), onCameraStrobe, FALLING);
+}
+
+/**
+ * Advance the LED once per strobe edge recorded by the ISR
+ */
+void updateVideoSequence() {
+  noInterrupts();
+  unsigned long count = strobeCount;
+  interrupts();
+  
+  // Timestamps of edges older than the queue have been overwritten
+  if (count - strobeProcessed > STROBE_QUEUE_SIZE) {
+    cameraErrorCode = CAMERA_ERROR_FRAME_OVERRUN;
+    sendCameraStatus();
+  }
+  
+  while (strobeProcessed < count) {
+    unsigned long edgeMicros = strobeMicros[strobeProcessed % STROBE_QUEUE_SIZE];
+    strobeProcessed++;
+    
+    // The edge ending the last step's frame completes the run
+    if ((int)strobeProcessed >= sequenceLength) {
+      finishVideoSequence();
+      return;
+    }
+    
+    // A frame is late if it already ended (more edges pending) or the LED
+    // changed too long after the edge; ingest drops late frames
+    boolean late = (strobeProcessed < count) || (micros() - edgeMicros > videoMaxLatencyUs);
+    showVideoFrame(strobeProcessed, edgeMicros, late);
+  }
+}
+
+/**
+ * Light the LED for a frame and log it
+ * Format: FRAME,frame,step,x,y,edgeMicros,late
+ */
+void showVideoFrame(unsigned long frame, unsigned long edgeMicros, boolean late) {
+  currentSequenceIndex = frame;
+  currentLedX = sequenceX[currentSequenceIndex];
+  currentLedY = sequenceY[currentSequenceIndex];
+  setLed(currentLedX, currentLedY, COLOR_GREEN);
+  
+  Serial.print("FRAME,");
+  Serial.print(frame);
+  Serial.print(",");
+  Serial.print(currentSequenceIndex);
+  Serial.print(",");
+  Serial.print(currentLedX);
+  Serial.print(",");
+  Serial.print(currentLedY);
+  Serial.print(",");
+  Serial.print(edgeMicros);
+  Serial.print(",");
+  Serial.println(late ? "1" : "0");
+}
+
+/**
+ * End a camera-as-master sequence
+ * Format: VIDEO,DONE,frames
+ */
+void finishVideoSequence() {
+  detachInterrupt(digitalPinToInterrupt(PIN_CAMERA_STROBE));
+  
+  Serial.print("VIDEO,DONE,");
+  Serial.println(sequenceLength);
+  
+  running = false;
+  currentSequenceIndex = 0;
+  turnOffLeds();
+  sendLedUpdate();
+  sendStatus();
+}
+
 void handleIdleMode() {
   // Check if it's time for a heartbeat blink
   unsigned long currentTime = millis();
@@ -607,7 +839,7 @@ void sendCameraStatus() {
 }
 
 /**
- * Trigger the camera shutter
+ * Trigger the camera shutter (blocking, used by the test command)
  * 
  * @param customPulseWidth Optional custom pulse width (use default if <= 0)
  * @return True if successful, false on error
@@ -624,11 +856,11 @@ bool triggerCamera(int customPulseWidth = -1) {
   sendCameraStatus();
   
   // Use custom or default pulse width
-  int pulseWidth = (customPulseWidth > 0) ? customPulseWidth : cameraPulseWidth;
+  int pulseWidth = (customPulseWidth > 0) ? customPulseWidth : cameraPulseWidth[0];
   
   // Pre-trigger delay for camera auto-exposure to adjust
-  if (cameraPreDelay > 0) {
-    delay(cameraPreDelay);
+  if (cameraPreDelay[0] > 0) {
+    delay(cameraPreDelay[0]);
   }
   
   // Set trigger pin high
@@ -639,8 +871,8 @@ bool triggerCamera(int customPulseWidth = -1) {
   digitalWrite(PIN_PHOTO_TRIGGER, LOW);
   
   // Post-trigger delay to ensure image is captured
-  if (cameraPostDelay > 0) {
-    delay(cameraPostDelay);
+  if (cameraPostDelay[0] > 0) {
+    delay(cameraPostDelay[0]);
   }
   
   // Reset trigger state and send status update
@@ -648,4 +880,235 @@ bool triggerCamera(int customPulseWidth = -1) {
   sendCameraStatus();
   
   return true;
-}
\ No newline at end of file
+}
+
+/**
+ * Parse exposure bracket settings
+ * Format: <count>,<pulseWidth1>,...,<pulseWidthN>
+ * 
+ * Missing or invalid pulse widths fall back to camera 0's pulse width.
+ */
+void parseBracketSettings(String value) {
+  int commaIndex = value.indexOf(',');
+  String countField = (commaIndex > 0) ? value.substring(0, commaIndex) : value;
+  int newCount = countField.toInt();
+  
+  if (newCount < 1 || newCount > MAX_BRACKET_EXPOSURES) {
+    Serial.println("Invalid bracket count");
+    return;
+  }
+  
+  // Parse each pulse width in turn
+  for (int i = 0; i < newCount; i++) {
+    int pulseWidth = cameraPulseWidth[0];
+    if (commaIndex > 0) {
+      int nextComma = value.indexOf(',', commaIndex + 1);
+      String field = (nextComma > 0) ? value.substring(commaIndex + 1, nextComma)
+                                     : value.substring(commaIndex + 1);
+      if (field.toInt() > 0) {
+        pulseWidth = field.toInt();
+      }
+      commaIndex = nextComma;
+    }
+    bracketPulseWidth[i] = pulseWidth;
+  }
+  
+  bracketCount = newCount;
+  
+  Serial.print("Bracket settings updated: ");
+  Serial.print(bracketCount);
+  Serial.println(" exposures");
+}
+
+/**
+ * Parse a camera timing profile
+ * Format: <camera>,<enabled>,<preDelay>,<pulseWidth>,<postDelay>
+ */
+void parseCameraProfile(String value) {
+  int fields[5];
+  int count = 0;
+  int start = 0;
+  
+  while (count < 5) {
+    int comma = value.indexOf(',', start);
+    fields[count++] = (comma >= 0) ? value.substring(start, comma).toInt() : value.substring(start).toInt();
+    if (comma < 0) break;
+    start = comma + 1;
+  }
+  
+  int cam = fields[0];
+  if (count < 5 || cam < 0 || cam >= NUM_CAMERAS || fields[3] <= 0) {
+    Serial.println("Invalid camera profile");
+    return;
+  }
+  
+  cameraOutputEnabled[cam] = fields[1] != 0;
+  cameraPreDelay[cam] = fields[2];
+  cameraPulseWidth[cam] = fields[3];
+  cameraPostDelay[cam] = fields[4];
+  
+  Serial.print("Camera ");
+  Serial.print(cam);
+  Serial.println(" profile updated");
+}
+
+/**
+ * Number of exposures a camera takes per LED (brackets apply to camera 0)
+ */
+int cameraShotCount(int cam) {
+  return (cam == 0) ? bracketCount : 1;
+}
+
+/**
+ * Pulse width of one exposure of a camera
+ */
+int cameraShotPulseWidth(int cam, int shot) {
+  if (cam == 0 && bracketCount > 1) {
+    return bracketPulseWidth[shot];
+  }
+  return cameraPulseWidth[cam];
+}
+
+void beginCameraPhase(int cam, byte state) {
+  cameraState[cam] = state;
+  cameraPhaseStart[cam] = millis();
+}
+
+/**
+ * Move a camera to its next exposure, or to idle after the last one
+ */
+void nextCameraShot(int cam) {
+  cameraShot[cam]++;
+  if (cameraShot[cam] < cameraShotCount(cam)) {
+    beginCameraPhase(cam, CAM_WAIT_READY);
+  } else {
+    cameraState[cam] = CAM_IDLE;
+  }
+}
+
+/**
+ * Start the exposures of every enabled camera for the current LED
+ * 
+ * The cameras then run independently in serviceCameras(), each with its own
+ * delays, so a slow camera does not stretch the timing of a fast one.
+ */
+void startCameraShots() {
+  cameraErrorCode = 0;
+  shotsPending = false;
+  
+  for (int cam = 0; cam < NUM_CAMERAS; cam++) {
+    if (cameraOutputEnabled[cam]) {
+      cameraShot[cam] = 0;
+      beginCameraPhase(cam, CAM_WAIT_READY);
+      shotsPending = true;
+    }
+  }
+}
+
+/**
+ * Advance every camera's state machine without blocking
+ * 
+ * Each trigger edge is reported as SHOT,camera,step,exposure so the files
+ * of every camera can be sorted into their own dataset.
+ * 
+ * @return True once all cameras are idle
+ */
+boolean serviceCameras() {
+  unsigned long now = millis();
+  boolean busy = false;
+  boolean pulseActive = false;
+  
+  for (int cam = 0; cam < NUM_CAMERAS; cam++) {
+    unsigned long elapsed = now - cameraPhaseStart[cam];
+    
+    switch (cameraState[cam]) {
+      case CAM_WAIT_READY:
+        if (digitalRead(cameraReadyPin[cam]) == HIGH) {
+          beginCameraPhase(cam, CAM_PRE_DELAY);
+        } else if (elapsed >= CAMERA_READY_TIMEOUT) {
+          // A skipped shot would shift every later file against its LED
+          abortSequenceOnCamera(cam);
+          return false;
+        }
+        break;
+        
+      case CAM_PRE_DELAY:
+        if (elapsed >= (unsigned long)cameraPreDelay[cam]) {
+          digitalWrite(cameraTriggerPin[cam], HIGH);
+          beginCameraPhase(cam, CAM_PULSE);
+          
+          Serial.print("SHOT,");
+          Serial.print(cam);
+          Serial.print(",");
+          Serial.print(currentSequenceIndex);
+          Serial.print(",");
+          Serial.println(cameraShot[cam]);
+        }
+        break;
+        
+      case CAM_PULSE:
+        if (elapsed >= (unsigned long)cameraShotPulseWidth(cam, cameraShot[cam])) {
+          digitalWrite(cameraTriggerPin[cam], LOW);
+          beginCameraPhase(cam, CAM_POST_DELAY);
+        }
+        break;
+        
+      case CAM_POST_DELAY:
+        if (elapsed >= (unsigned long)cameraPostDelay[cam]) {
+          nextCameraShot(cam);
+        }
+        break;
+    }
+    
+    if (cameraState[cam] == CAM_PULSE) pulseActive = true;
+    if (cameraState[cam] != CAM_IDLE) busy = true;
+  }
+  
+  // Report trigger activity on any output
+  if (pulseActive != cameraTriggerActive) {
+    cameraTriggerActive = pulseActive;
+    sendCameraStatus();
+  }
+  
+  return !busy;
+}
+
+/**
+ * Stop the sequence after a camera missed a shot
+ * Format: SEQUENCE,ERROR,camera timeout,camera,step,exposure
+ */
+void abortSequenceOnCamera(int cam) {
+  cameraErrorCode = CAMERA_ERROR_TIMEOUT;
+  sendCameraStatus();
+  
+  Serial.print("SEQUENCE,ERROR,camera timeout,");
+  Serial.print(cam);
+  Serial.print(",");
+  Serial.print(currentSequenceIndex);
+  Serial.print(",");
+  Serial.println(cameraShot[cam]);
+  
+  abortCameraShots();
+  running = false;
+  calibrating = false;
+  currentSequenceIndex = 0;
+  turnOffLeds();
+  sendLedUpdate();
+  sendStatus();
+}
+
+/**
+ * Drop any exposures in progress and release all trigger outputs
+ */
+void abortCameraShots() {
+  for (int cam = 0; cam < NUM_CAMERAS; cam++) {
+    digitalWrite(cameraTriggerPin[cam], LOW);
+    cameraState[cam] = CAM_IDLE;
+  }
+  shotsPending = false;
+  
+  if (cameraTriggerActive) {
+    cameraTriggerActive = false;
+    sendCameraStatus();
+  }
+}
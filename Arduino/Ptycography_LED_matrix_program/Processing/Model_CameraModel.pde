@@ -14,6 +14,21 @@ class CameraModel extends EventDispatcher {
   private int pulseWidth = 100;      // Trigger pulse width in ms
   private int postDelay = 1500;      // Delay after trigger in ms
   
+  // Exposure bracketing - one pulse width per exposure taken at each LED
+  public static final int MAX_BRACKET_EXPOSURES = 8;
+  private int[] bracketPulseWidths = new int[0];  // Empty = single exposure using pulseWidth
+  
+  // Camera-as-master video mode - the camera's strobe output advances the LEDs
+  private boolean videoMode = false;
+  
+  // Multi-camera fanout - the settings above drive camera 0, the firmware's
+  // other trigger outputs each get their own timing profile
+  public static final int NUM_CAMERAS = 2;
+  private boolean[] cameraOutputEnabled = {true, false};
+  private int[] cameraPreDelays = {400, 400};
+  private int[] cameraPulseWidths = {100, 100};
+  private int[] cameraPostDelays = {1500, 1500};
+  
   // Camera status
   private boolean triggerActive = false;
   private int lastTriggerTime = 0;
@@ -25,6 +40,7 @@ class CameraModel extends EventDispatcher {
   public static final int ERROR_TIMEOUT = 1;
   public static final int ERROR_TRIGGER_FAILURE = 2;
   public static final int ERROR_NOT_READY = 3;
+  public static final int ERROR_FRAME_OVERRUN = 4;
   
   /**
    * Constructor with default settings
@@ -154,6 +170,9 @@ class CameraModel extends EventDispatcher {
       case ERROR_NOT_READY:
         errorStatus = "NOT READY";
         break;
+      case ERROR_FRAME_OVERRUN:
+        errorStatus = "FRAME OVERRUN";
+        break;
       default:
         errorStatus = "ERROR " + errorCode;
         break;
@@ -206,6 +225,84 @@ class CameraModel extends EventDispatcher {
     }
   }
   
+  public int[] getBracketPulseWidths() {
+    return bracketPulseWidths;
+  }
+  
+  public int getBracketCount() {
+    return max(1, bracketPulseWidths.length);
+  }
+  
+  /**
+   * Set the exposure bracket (pulse width in ms per exposure).
+   * An empty array disables bracketing.
+   */
+  public void setBracketPulseWidths(int[] widths) {
+    if (widths == null || widths.length > MAX_BRACKET_EXPOSURES) return;
+    
+    for (int i = 0; i < widths.length; i++) {
+      if (widths[i] <= 0) return;
+    }
+    
+    if (!java.util.Arrays.equals(bracketPulseWidths, widths)) {
+      bracketPulseWidths = widths.clone();
+      publishEvent(EventType.CAMERA_STATUS_CHANGED);
+    }
+  }
+  
+  public boolean isVideoMode() {
+    return videoMode;
+  }
+  
+  public void setVideoMode(boolean videoMode) {
+    if (this.videoMode != videoMode) {
+      this.videoMode = videoMode;
+      publishEvent(EventType.CAMERA_STATUS_CHANGED);
+    }
+  }
+  
+  /**
+   * Get video mode command for Arduino
+   * Format: V<0|1>
+   */
+  public String getVideoModeCommand(char commandChar) {
+    return commandChar + (videoMode ? "1" : "0");
+  }
+  
+  public boolean isCameraOutputEnabled(int cam) {
+    return cameraOutputEnabled[cam];
+  }
+  
+  public int getCameraPreDelay(int cam) {
+    return cameraPreDelays[cam];
+  }
+  
+  public int getCameraPulseWidth(int cam) {
+    return cameraPulseWidths[cam];
+  }
+  
+  public int getCameraPostDelay(int cam) {
+    return cameraPostDelays[cam];
+  }
+  
+  /**
+   * Set the timing profile of one of the secondary trigger outputs (1..NUM_CAMERAS-1).
+   * Camera 0 is configured through the regular camera settings.
+   */
+  public void setCameraProfile(int cam, boolean outputEnabled, int preDelay, int pulseWidth, int postDelay) {
+    if (cam < 1 || cam >= NUM_CAMERAS) return;
+    if (preDelay < 0 || pulseWidth <= 0 || postDelay < 0) return;
+    
+    if (cameraOutputEnabled[cam] != outputEnabled || cameraPreDelays[cam] != preDelay ||
+        cameraPulseWidths[cam] != pulseWidth || cameraPostDelays[cam] != postDelay) {
+      cameraOutputEnabled[cam] = outputEnabled;
+      cameraPreDelays[cam] = preDelay;
+      cameraPulseWidths[cam] = pulseWidth;
+      cameraPostDelays[cam] = postDelay;
+      publishEvent(EventType.CAMERA_STATUS_CHANGED);
+    }
+  }
+  
   public boolean isTriggerActive() {
     return triggerActive;
   }
@@ -251,6 +348,35 @@ class CameraModel extends EventDispatcher {
            postDelay;
   }
   
+  /**
+   * Get bracket settings as a formatted string for Arduino command
+   * Format: <commandChar>B,<count>,<pulseWidth1>,...,<pulseWidthN>
+   */
+  public String getBracketCommand(char commandChar) {
+    if (bracketPulseWidths.length == 0) {
+      return commandChar + "B,1," + pulseWidth;
+    }
+    
+    String command = commandChar + "B," + bracketPulseWidths.length;
+    for (int i = 0; i < bracketPulseWidths.length; i++) {
+      command += "," + bracketPulseWidths[i];
+    }
+    return command;
+  }
+  
+  /**
+   * Get a secondary camera's timing profile as a formatted string for Arduino command
+   * Format: <commandChar>M,<camera>,<enabled>,<preDelay>,<pulseWidth>,<postDelay>
+   */
+  public String getCameraProfileCommand(char commandChar, int cam) {
+    return commandChar + 
+           "M," + cam + "," +
+           (cameraOutputEnabled[cam] ? "1" : "0") + "," +
+           cameraPreDelays[cam] + "," +
+           cameraPulseWidths[cam] + "," +
+           cameraPostDelays[cam];
+  }
+  
   /**
    * Get test trigger command for Arduino
    */
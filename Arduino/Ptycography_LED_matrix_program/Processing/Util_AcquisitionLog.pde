@@ -0,0 +1,92 @@
+/**
+ * AcquisitionLog.pde
+ *
+ * Records the frame-to-LED timeline reported by the Arduino.
+ *
+ * In video mode each FRAME line from the firmware becomes one CSV row, so
+ * the ingest stage can map every video frame back to the LED that lit it:
+ *   acquisitions/video_*.csv   frame,step,x,y,edgeMicros,late
+ *
+ * In triggered mode each SHOT line becomes one row, so the files of every
+ * camera of a multi-camera run can be sorted into their own dataset:
+ *   acquisitions/shots_*.csv   camera,step,exposure
+ */
+
+class AcquisitionLog {
+  private PrintWriter writer;
+  private String filePath;
+  private int frameCount = 0;
+  private int lateCount = 0;
+  private boolean hasLateField = true;
+  
+  /**
+   * Open a new video mode log file named after the current date and time
+   */
+  public void start() {
+    start("video", "frame,step,x,y,edgeMicros,late");
+  }
+  
+  /**
+   * Open a new log file named <kind>_<date and time>.csv with a header row
+   */
+  public void start(String kind, String header) {
+    close();
+    
+    filePath = sketchPath("acquisitions/" + kind + "_" +
+                          nf(year(), 4) + "-" + nf(month(), 2) + "-" + nf(day(), 2) + "_" +
+                          nf(hour(), 2) + "-" + nf(minute(), 2) + "-" + nf(second(), 2) + ".csv");
+    writer = createWriter(filePath);
+    writer.println(header);
+    frameCount = 0;
+    lateCount = 0;
+    hasLateField = header.endsWith(",late");
+    
+    println("Recording acquisition log to: " + filePath);
+  }
+  
+  /**
+   * Append one record (the comma-separated fields after "FRAME," or "SHOT,")
+   */
+  public void logFrame(String fields) {
+    if (writer == null) return;
+    
+    writer.println(fields);
+    frameCount++;
+    if (hasLateField && fields.endsWith(",1")) {
+      lateCount++;
+    }
+  }
+  
+  /**
+   * Flush and close the log file
+   */
+  public void close() {
+    if (writer == null) return;
+    
+    writer.flush();
+    writer.close();
+    writer = null;
+    
+    if (hasLateField) {
+      println("Acquisition log closed: " + frameCount + " frames, " + lateCount + " late");
+    } else {
+      println("Acquisition log closed: " + frameCount + " records");
+    }
+  }
+  
+  public boolean isRecording() {
+    return writer != null;
+  }
+  
+  public String getFilePath() {
+    return filePath;
+  }
+  
+  public int getFrameCount() {
+    return frameCount;
+  }
+  
+  public int getLateCount() {
+    return lateCount;
+  }
+}
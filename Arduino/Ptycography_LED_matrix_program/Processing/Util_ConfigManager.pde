@@ -131,6 +131,9 @@ class ConfigManager extends EventDispatcher {
     cameraConfig.setInt("preDelay", DEFAULT_CAMERA_PRE_DELAY);
     cameraConfig.setInt("pulseWidth", DEFAULT_CAMERA_PULSE_WIDTH);
     cameraConfig.setInt("postDelay", DEFAULT_CAMERA_POST_DELAY);
+    cameraConfig.setJSONArray("bracketPulseWidths", new JSONArray());
+    cameraConfig.setBoolean("videoMode", false);
+    cameraConfig.setJSONArray("secondaryCameras", new JSONArray());
     config.setJSONObject("camera", cameraConfig);
     
     // Hardware settings
@@ -265,7 +268,13 @@ class ConfigManager extends EventDispatcher {
       cameraConfig.setInt("preDelay", DEFAULT_CAMERA_PRE_DELAY);
       cameraConfig.setInt("pulseWidth", DEFAULT_CAMERA_PULSE_WIDTH);
       cameraConfig.setInt("postDelay", DEFAULT_CAMERA_POST_DELAY);
+      cameraConfig.setJSONArray("bracketPulseWidths", new JSONArray());
       config.setJSONObject("camera", cameraConfig);
+    } else if (!config.getJSONObject("camera").hasKey("bracketPulseWidths")) {
+      config.getJSONObject("camera").setJSONArray("bracketPulseWidths", new JSONArray());
+    }
+    if (!config.getJSONObject("camera").hasKey("secondaryCameras")) {
+      config.getJSONObject("camera").setJSONArray("secondaryCameras", new JSONArray());
     }
     
     // Check hardware config
@@ -354,6 +363,25 @@ class ConfigManager extends EventDispatcher {
     cameraConfig.setInt("preDelay", model.getPreDelay());
     cameraConfig.setInt("pulseWidth", model.getPulseWidth());
     cameraConfig.setInt("postDelay", model.getPostDelay());
+    
+    JSONArray bracket = new JSONArray();
+    int[] widths = model.getBracketPulseWidths();
+    for (int i = 0; i < widths.length; i++) {
+      bracket.setInt(i, widths[i]);
+    }
+    cameraConfig.setJSONArray("bracketPulseWidths", bracket);
+    cameraConfig.setBoolean("videoMode", model.isVideoMode());
+    
+    JSONArray secondary = new JSONArray();
+    for (int cam = 1; cam < CameraModel.NUM_CAMERAS; cam++) {
+      JSONObject profile = new JSONObject();
+      profile.setBoolean("enabled", model.isCameraOutputEnabled(cam));
+      profile.setInt("preDelay", model.getCameraPreDelay(cam));
+      profile.setInt("pulseWidth", model.getCameraPulseWidth(cam));
+      profile.setInt("postDelay", model.getCameraPostDelay(cam));
+      secondary.setJSONObject(cam - 1, profile);
+    }
+    cameraConfig.setJSONArray("secondaryCameras", secondary);
     config.setJSONObject("camera", cameraConfig);
   }
   
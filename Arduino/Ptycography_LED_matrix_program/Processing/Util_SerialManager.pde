@@ -22,6 +22,11 @@ class SerialManager extends EventDispatcher {
   public static final char CMD_EXIT_IDLE = 'a';        // Exit idle mode
   public static final char CMD_SET_LED = 'L';          // Set specific LED
   public static final char CMD_SET_CAMERA = 'C';       // Set camera trigger settings
+  public static final char CMD_CALIBRATE = 'K';        // Run a single calibration sweep
+  public static final char CMD_VIDEO_MODE = 'V';       // Camera-as-master video mode
+  
+  // Must match Serial.begin() in the Arduino sketch
+  public static final int BAUD_RATE = 115200;
   
   // Serial port connection
   private Serial arduinoPort;
@@ -36,6 +41,12 @@ class SerialManager extends EventDispatcher {
   // Callback for serial events
   private SerialEventCallback callback;
   
+  // Frame-to-LED timeline recorded during video mode acquisitions
+  private AcquisitionLog acquisitionLog = new AcquisitionLog();
+  
+  // Per-shot trigger log of triggered acquisitions, one row per SHOT line
+  private AcquisitionLog shotLog = new AcquisitionLog();
+  
   /**
    * Constructor
    */
@@ -72,7 +83,7 @@ class SerialManager extends EventDispatcher {
     
     try {
       // Connect to the selected port
-      arduinoPort = new Serial(getPApplet(), availablePorts[portIndex], 9600);
+      arduinoPort = new Serial(getPApplet(), availablePorts[portIndex], BAUD_RATE);
       arduinoPort.bufferUntil('\n');
       connected = true;
       
@@ -138,6 +149,35 @@ class SerialManager extends EventDispatcher {
     } else if (data.startsWith("CAMERA,")) {
       // Format: CAMERA,triggerActive,errorCode
       parseArduinoCameraData(data);
+    } else if (data.startsWith("FRAME,")) {
+      // Format: FRAME,frame,step,x,y,edgeMicros,late
+      parseArduinoFrameData(data);
+    } else if (data.startsWith("SHOT,")) {
+      // Format: SHOT,camera,step,exposure
+      if (!shotLog.isRecording()) {
+        shotLog.start("shots", "camera,step,exposure");
+      }
+      shotLog.logFrame(data.substring(5));
+    } else if (data.startsWith("SEQUENCE,ERROR")) {
+      // Format: SEQUENCE,ERROR,reason,camera,step,exposure
+      println("Sequence aborted by the hardware: " + data.substring(15));
+      shotLog.close();
+      stateModel.stopSequence();
+    } else if (data.startsWith("VIDEO,START")) {
+      acquisitionLog.start();
+    } else if (data.startsWith("VIDEO,DONE")) {
+      // Format: VIDEO,DONE,frames
+      acquisitionLog.close();
+      stateModel.stopSequence();
+    } else if (data.startsWith("CALIBRATION,DONE")) {
+      // Format: CALIBRATION,DONE,steps
+      println("Calibration sweep complete");
+      shotLog.close();
+      stateModel.stopSequence();
+    } else if (data.startsWith("CALIBRATION,ERROR")) {
+      // Format: CALIBRATION,ERROR,reason
+      println("Calibration sweep rejected: " + data.substring(18));
+      stateModel.stopSequence();
     }
   }
   
@@ -195,6 +235,27 @@ class SerialManager extends EventDispatcher {
     }
   }
   
+  /**
+   * Parse video mode frame data from Arduino
+   * Format: FRAME,frame,step,x,y,edgeMicros,late
+   */
+  private void parseArduinoFrameData(String data) {
+    String fields = data.substring(6);
+    String[] parts = fields.split(",");
+    if (parts.length >= 6) {
+      try {
+        int x = Integer.parseInt(parts[2]);
+        int y = Integer.parseInt(parts[3]);
+        
+        // Log first so the timeline is complete even if the display lags
+        acquisitionLog.logFrame(fields);
+        stateModel.updateCurrentLed(x, y, 2);  // Green, as lit by the firmware
+      } catch (Exception e) {
+        println("Error parsing frame data: " + e.getMessage());
+      }
+    }
+  }
+  
   /**
    * Parse camera data from Arduino
    * Format: CAMERA,triggerActive,errorCode
@@ -284,15 +345,19 @@ class SerialManager extends EventDispatcher {
   public void sendCameraSettings() {
     if (!connected) return;
     
-    // Format camera settings command
-    String command = CMD_SET_CAMERA + 
-                   "S," +  // S for settings
-                   (cameraModel.isEnabled() ? "1" : "0") + "," +
-                   cameraModel.getPreDelay() + "," +
-                   cameraModel.getPulseWidth() + "," +
-                   cameraModel.getPostDelay();
+    // Send camera settings command: CS,<enabled>,<preDelay>,<pulseWidth>,<postDelay>
+    sendCommand(cameraModel.getSettingsCommand(CMD_SET_CAMERA));
     
-    sendCommand(command);
+    // Send exposure bracket (B,1,<pulseWidth> when bracketing is off)
+    sendCommand(cameraModel.getBracketCommand(CMD_SET_CAMERA));
+    
+    // Send the timing profiles of the secondary trigger outputs
+    for (int cam = 1; cam < CameraModel.NUM_CAMERAS; cam++) {
+      sendCommand(cameraModel.getCameraProfileCommand(CMD_SET_CAMERA, cam));
+    }
+    
+    // Send acquisition mode (firmware-timed stills or camera-as-master video)
+    sendCommand(cameraModel.getVideoModeCommand(CMD_VIDEO_MODE));
   }
   
   /**
@@ -318,12 +383,21 @@ class SerialManager extends EventDispatcher {
     sendCommand(String.valueOf(CMD_START_SEQUENCE));
   }
   
+  /**
+   * Send a command to run a single calibration sweep over every LED
+   */
+  public void startCalibration() {
+    if (!connected) return;
+    sendCommand(String.valueOf(CMD_CALIBRATE));
+  }
+  
   /**
    * Send a command to stop the sequence
    */
   public void stopSequence() {
     if (!connected) return;
     sendCommand(String.valueOf(CMD_STOP_SEQUENCE));
+    shotLog.close();
   }
   
   /**
@@ -356,6 +430,20 @@ class SerialManager extends EventDispatcher {
     return availablePorts;
   }
   
+  /**
+   * Get the video mode acquisition log
+   */
+  public AcquisitionLog getAcquisitionLog() {
+    return acquisitionLog;
+  }
+  
+  /**
+   * Get the per-shot trigger log of triggered acquisitions
+   */
+  public AcquisitionLog getShotLog() {
+    return shotLog;
+  }
+  
   /**
    * Check if we're connected to hardware
    */
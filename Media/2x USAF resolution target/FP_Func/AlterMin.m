@@ -12,7 +12,9 @@ function [O, P, err, scale, Ns] = AlterMin( I, No, Ns, opts)
 %
 %   Inputs:
 % Measurements data
-%   I: intensity measurements by different LEDs
+%   I: intensity measurements by different LEDs, floating point or an
+%   integer stack (e.g. uint16) that is converted one image at a time
+%   (see Iscale)
 % Reconstruction parameters
 %   No = [Ny_obj,Nx_obj]: size of the reconstructed image
 % Illumination coding parameters
@@ -33,6 +35,8 @@ function [O, P, err, scale, Ns] = AlterMin( I, No, Ns, opts)
     %   OP_alpha: regularization parameter for O
     %   OP_beta: regularization parameter for P
 %   scale: LED brightness map
+%   scaleUpdate: re-estimate each image's scale every pass by least squares
+        % between I_est and I_mea, no extra transforms (0: no (default) 1: yes)
 %   H0: known portion of the aberration function,
         % e.g. sample with a known defocus induce a quardratic aberration
         % function can be defined here
@@ -43,6 +47,27 @@ function [O, P, err, scale, Ns] = AlterMin( I, No, Ns, opts)
     % 'ga': genetic algorithm
     % caution: takes consierably much longer time to compute a single iteration
 %   F, Ft: operators of Fourier transform and inverse
+%   In 'fourier' mode O is kept only over the bounding box of the union of
+        % the crop windows (the synthetic aperture) while iterating, and is
+        % padded back to No for display and the final inverse transform
+%   imgSubset: indices of the images visited in each pass (default: all)
+%   errTarget: stop as soon as the error drops to this level (default 0)
+%   schedule: 'fixed' (default) visits every image once per iteration,
+        % 'residual' visits only the scheduleFrac of the images with the
+        % largest residual at their last visit, and every image only on
+        % every fullPassPeriod-th iteration. err and the stopping tests
+        % only use those full passes; maxIter and minIter count all passes
+%   fullPassPeriod: one full pass every this many iterations (default 3)
+%   scheduleFrac: fraction of the images visited in the other ones
+        % (default 0.25)
+%   precision: 'double' (default) or 'single' storage and arithmetic for
+        % I, O and P. An integer I stays in its own type and each image is
+        % converted when visited
+%   Iscale: per-image factor from the stored values of I to intensity,
+        % for stacks quantized with a per-frame step (default 1)
+%   fft_threads: FFTW threads used inside each 2-D transform, so a single
+        % large Np patch and the final N_obj inverse use all cores
+        % (0, default: keep the current fftw setting)
 
 % Last modified on 10/07/2017
 % by Lei Tian, lei_tian@alum.mit.edu
@@ -66,7 +91,7 @@ if nargin<4
     opts.display = 0;
     opts.saveIterResult = 0;
     opts.out_dir = [];
-    opts.O0 = Ft(sqrt(I(:,:,1)))/r0;
+    opts.O0 = Ft(sqrt(double(I(:,:,1))))/r0;
     opts.O0 = padarray(opts.O0,(No-Np)/2);
     opts.P0 = ones(Np);
     opts.OP_alpha = 1;
@@ -78,6 +103,14 @@ if nargin<4
     opts.calbratetol = 1e-1;
     opts.F = @(x) fftshift(fft2(x));
     opts.Ft = @(x) ifft2(ifftshift(x));
+    opts.scaleUpdate = 0;
+    opts.imgSubset = 1:Nimg;
+    opts.errTarget = 0;
+    opts.schedule = 'fixed';
+    opts.fullPassPeriod = 3;
+    opts.scheduleFrac = 0.25;
+    opts.precision = 'double';
+    opts.Iscale = ones(1,Nimg);
 else
     if ~isfield(opts,'tol')
         opts.tol = 1;
@@ -103,8 +136,11 @@ else
             mkdir(opts.out_dir);
         end
     end
+    if ~isfield(opts,'Iscale')
+        opts.Iscale = ones(1,Nimg);
+    end
     if ~isfield(opts,'O0')
-        opts.O0 = Ft(sqrt(I(:,:,1)))/r0;
+        opts.O0 = Ft(sqrt(double(I(:,:,1))*opts.Iscale(1)))/r0;
         opts.O0 = padarray(opts.O0,(No-Np)/2);
     end
     if ~isfield(opts,'P0')
@@ -131,6 +167,9 @@ else
     if ~isfield(opts,'scale')
         opts.scale = ones(Nled,1);
     end
+    if ~isfield(opts,'scaleUpdate')
+        opts.scaleUpdate = 0;
+    end
 
     if ~isfield(opts,'H0')
         opts.H0 = ones(Np);
@@ -147,6 +186,32 @@ else
     if ~isfield(opts,'calbratetol')
         opts.calbratetol = 1e-1;
     end
+    if ~isfield(opts,'fft_threads')
+        opts.fft_threads = 0;
+    end
+    if ~isfield(opts,'imgSubset')
+        opts.imgSubset = 1:Nimg;
+    end
+    if ~isfield(opts,'errTarget')
+        opts.errTarget = 0;
+    end
+    if ~isfield(opts,'schedule')
+        opts.schedule = 'fixed';
+    end
+    if ~isfield(opts,'fullPassPeriod')
+        opts.fullPassPeriod = 3;
+    end
+    if ~isfield(opts,'scheduleFrac')
+        opts.scheduleFrac = 0.25;
+    end
+    if ~isfield(opts,'precision')
+        opts.precision = 'double';
+    end
+end
+
+if isfield(opts,'fft_threads') && opts.fft_threads > 0
+    fft_threads0 = fftw('threads');
+    fftw('threads',opts.fft_threads);
 end
 
 H0 = opts.H0;
@@ -155,9 +220,23 @@ Ft = opts.Ft;
 
 %% Operators
 Ps = opts.Ps;
-% operator to crop region of O from proper location at the O plane
-downsamp = @(x,cen) x(cen(1)-floor(Np(1)/2):cen(1)-floor(Np(1)/2)+Np(1)-1,...
-    cen(2)-floor(Np(2)/2):cen(2)-floor(Np(2)/2)+Np(2)-1);
+% operator to crop region of O from proper location at the O plane, the
+% offsets of the window from its center are fixed by Np
+rv = (0:Np(1)-1)-floor(Np(1)/2);
+rh = (0:Np(2)-1)-floor(Np(2)/2);
+downsamp = @(x,cen) x(cen(1)+rv,cen(2)+rh);
+% O/P update for the rank of the illumination pattern, chosen once here
+% instead of being rebuilt for every image
+if r0 == 1
+    P2 = @(O,P,dpsi,Omax,cen)...
+        GDUpdate_Multiplication_rank1(O,P,dpsi,Omax,cen,Ps,...
+        opts.OP_alpha,opts.OP_beta, opts.StepSize);
+else
+    P2 = @(O,P,dpsi,Omax,cen)...
+        GDUpdate_Multiplication_rank_r(O,P,dpsi,Omax,cen,Ps,...
+        opts.OP_alpha,opts.OP_beta);
+end
+H0r = repmat(H0,[1,1,r0]);
 
 T0 = clock;
 
@@ -176,6 +255,18 @@ err = [];
 iter = 0;
 scale = opts.scale;
 scale = reshape(scale,r0,Nimg);
+icls = 'double';
+if strcmp(opts.precision,'single')
+    icls = 'single';
+    if isfloat(I)
+        I = single(I);
+    end
+    O = single(O);
+    P = single(P);
+end
+scale_mean = mean(scale(:));
+% residual of each image at its last visit, for the 'residual' schedule
+res = inf(1,Nimg);
 
 if opts.display
     if strcmp(opts.mode,'real')
@@ -212,25 +303,60 @@ fprintf('| %2d   | %.2e |\n',iter,err1);
 
 sp0 = max(row(abs(Ns(:,1,:)-Ns(:,2,:))));
 
+%% Fourier support
+% only the crop windows are ever read or written, so the spectrum outside
+% their union is dropped. Position correction may move a window by up to
+% sp0/3, which is kept as a margin
+box = [1,No(1),1,No(2)];
+if strcmp(opts.mode,'fourier')
+    margin = 0;
+    if ~isequal(opts.poscalibrate,0)
+        margin = ceil(sp0/3);
+    end
+    cc = [cen0(:),cen0(:)-reshape(permute(Ns,[3,1,2]),2,[])];
+    box = [max(1,min(cc(1,:))+rv(1)-margin), min(No(1),max(cc(1,:))+rv(end)+margin),...
+        max(1,min(cc(2,:))+rh(1)-margin), min(No(2),max(cc(2,:))+rh(end)+margin)];
+    O = O(box(1):box(2),box(3):box(4));
+    cen0 = cen0-[box(1),box(3)]+1;
+    fprintf('Fourier support %d x %d of %d x %d\n',size(O,1),size(O,2),No(1),No(2));
+end
+
 while abs(err1-err2)>opts.tol&&iter<opts.maxIter
 %     psistack = zeros(64,64,293);
-    err1 = err2;
-    err2 = 0;
     iter = iter+1;
-    for m = 1:Nimg
+    % crop centers of every image for this pass, Ns only changes here
+    % when positions are being calibrated
+    cen_all = cen0(:)-permute(Ns,[3,1,2]);
+    % images visited in this pass, in NA order. Until every image has a
+    % residual all passes are full
+    visits = row(opts.imgSubset);
+    fullpass = ~strcmp(opts.schedule,'residual') || ...
+        mod(iter,opts.fullPassPeriod) == 0 || any(~isfinite(res(visits)));
+    if fullpass
+        err1 = err2;
+        err2 = 0;
+    else
+        [~,ord] = sort(res(visits),'descend');
+        visits = visits(sort(ord(1:ceil(opts.scheduleFrac*numel(visits)))));
+    end
+    for m = visits
         % initilize psi for correponing image, ROI determined by cen
-        Psi0 = zeros(Np(1),Np(2),r0);
-        Psi_scale = zeros(Np(1),Np(2),r0);
-        cen = zeros(2,r0);
-        scale0 = zeros(r0,1);
-        for p = 1:r0
-            cen(:,p) = cen0-row(Ns(p,m,:));
-            scale0(p) = scale(p,m);
-            Psi0(:,:,p) = downsamp(O,cen(:,p)).*P.*H0;
-            Psi_scale(:,:,p) = sqrt(scale0(p))*Psi0(:,:,p);
+        cen = cen_all(:,:,m);
+        scale0 = scale(:,m);
+        if r0 == 1
+            Psi0 = downsamp(O,cen).*P.*H0;
+            Psi_scale = sqrt(scale0)*Psi0;
+        else
+            Psi0 = zeros(Np(1),Np(2),r0);
+            Psi_scale = zeros(Np(1),Np(2),r0);
+            PH0 = P.*H0;
+            for p = 1:r0
+                Psi0(:,:,p) = downsamp(O,cen(:,p)).*PH0;
+                Psi_scale(:,:,p) = sqrt(scale0(p))*Psi0(:,:,p);
+            end
         end
         % measured intensity
-        I_mea = I(:,:,m);
+        I_mea = cast(I(:,:,m),icls)*opts.Iscale(m);
         % compute field in real space
         psi0 = Ft(Psi_scale);
 %         psistack(:,:,m) = psi0;
@@ -240,16 +366,7 @@ while abs(err1-err2)>opts.tol&&iter<opts.maxIter
         % projection 2
         dPsi = Psi-Psi0;
         Omax = abs(O(cen0(1),cen0(2)));
-        if r0 == 1
-            P2 = @(O,P,dpsi,Omax,cen)...
-                GDUpdate_Multiplication_rank1(O,P,dpsi,Omax,cen,Ps,...
-                opts.OP_alpha,opts.OP_beta, opts.StepSize);
-        else
-            P2 = @(O,P,dpsi,Omax,cen)...
-                GDUpdate_Multiplication_rank_r(O,P,dpsi,Omax,cen,Ps,...
-                opts.OP_alpha,opts.OP_beta);
-        end
-        [O,P] = P2(O,P,dPsi./repmat(H0,[1,1,r0]),Omax,cen);
+        [O,P] = P2(O,P,dPsi./H0r,Omax,cen);
 
         %% position correction
         poscost = @(ss) sum(sum((abs(Ft(downsamp(O,ss).*P.*H0)).^2-I_mea).^2));
@@ -265,14 +382,29 @@ while abs(err1-err2)>opts.tol&&iter<opts.maxIter
             Ns(:,m,:) = cen0-cen_correct;
         end
         % compute the total difference to determine stopping criterion
-        err2 = err2+sqrt(sum(sum((I_mea-I_est).^2)));
+        res(m) = sqrt(sum(sum((I_mea-I_est).^2)));
+        if fullpass
+            err2 = err2+res(m);
+        end
+
+        %% brightness correction
+        % I_est already carries scale0, the factor a minimizing
+        % ||I_mea-a*I_est|| rescales it, applied from the next pass
+        if opts.scaleUpdate
+            a = sum(I_mea(:).*I_est(:))/(sum(I_est(:).^2)+eps);
+            scale(:,m) = scale0*a;
+        end
 
     end
+    if opts.scaleUpdate
+        % O absorbs any common factor, so keep the mean brightness fixed
+        scale = scale*scale_mean/mean(scale(:));
+    end
     if strcmp(opts.display,'full')
         if strcmp(opts.mode,'real')
             o = O;
         elseif strcmp(opts.mode,'fourier')
-            o = Ft(O);
+            o = Ft(Embed_Support(O,No,box));
         end
         f1 = figure(88);
         subplot(221); imagesc(abs(o)); axis image; colormap gray; colorbar;
@@ -287,6 +419,11 @@ while abs(err1-err2)>opts.tol&&iter<opts.maxIter
     end
     %end
 
+    % partial passes leave err1/err2, and so the stopping tests, untouched
+    if ~fullpass
+        continue;
+    end
+
     %% compute error
     % record the error and can check the convergence later.
     err = [err,err2];
@@ -295,7 +432,7 @@ while abs(err1-err2)>opts.tol&&iter<opts.maxIter
         if strcmp(opts.mode,'real')
             o = O;
         elseif strcmp(opts.mode,'fourier')
-            o = Ft(O);
+            o = Ft(Embed_Support(O,No,box));
         end
         f1 = figure(88);
         subplot(221); imagesc(abs(o)); axis image; colormap gray; colorbar;
@@ -316,6 +453,10 @@ while abs(err1-err2)>opts.tol&&iter<opts.maxIter
         %     saveas(f2,[opts.out_dir,'\Ph_',num2str(iter),'.png']);
     end
 
+    if err2 <= opts.errTarget
+        break;
+    end
+
     if opts.monotone&&iter>opts.minIter
         if err2>err1
             break;
@@ -325,10 +466,56 @@ while abs(err1-err2)>opts.tol&&iter<opts.maxIter
 
 end
 if strcmp(opts.mode,'fourier')
-    O = Ft(O);
+    O = Ft(Embed_Support(O,No,box));
 end
 
 fprintf('elapsed time: %.0f seconds\n',etime(clock,T0));
 
+if isfield(opts,'fft_threads') && opts.fft_threads > 0
+    fftw('threads',fft_threads0);
+end
+
+end
+
+function Of = Embed_Support(O,No,box)
+% place the support-cropped spectrum back on the full No grid
+Of = zeros(No);
+Of(box(1):box(2),box(3):box(4)) = O;
 end
 
+%!test
+%! % a uint16 stack quantized per frame as in main.m reconstructs the same
+%! % object as the double stack
+%! Np = 32; No = 64;
+%! F = @(x) fftshift(fft2(x));
+%! Ft = @(x) ifft2(ifftshift(x));
+%! rv = (0:Np-1)-Np/2;
+%! cen0 = No/2+1;
+%! [xx,yy] = meshgrid(rv);
+%! w = double(hypot(xx,yy) < 8);
+%! [x,y] = meshgrid(1:No);
+%! Otrue = F((1+0.3*cos(x/5)).*exp(1i*sin(y/7+x/11)));
+%! [sx,sy] = meshgrid(-12:6:12);
+%! Nimg = numel(sx);
+%! Ns = zeros(1,Nimg,2);
+%! Ns(1,:,1) = sy(:); Ns(1,:,2) = sx(:);
+%! I = zeros(Np,Np,Nimg);
+%! for m = 1:Nimg
+%!   c = cen0-[Ns(1,m,1),Ns(1,m,2)];
+%!   I(:,:,m) = abs(Ft(Otrue(c(1)+rv,c(2)+rv).*w)).^2;
+%! end
+%! Iq = zeros(Np,Np,Nimg,'uint16');
+%! Iscale = zeros(1,Nimg);
+%! for m = 1:Nimg
+%!   Iscale(m) = max(max(I(:,:,m)))/65535;
+%!   Iq(:,:,m) = uint16(I(:,:,m)/Iscale(m));
+%! end
+%! opts = struct('tol',-1,'maxIter',5,'minIter',1,'monotone',0,'display',0,...
+%!   'mode','fourier','P0',w,'Ps',w,'scale',ones(Nimg,1),'OP_alpha',1,...
+%!   'OP_beta',1e3,'StepSize',0.1,'F',F,'Ft',Ft);
+%! opts.O0 = zeros(No);
+%! opts.O0(cen0+rv,cen0+rv) = F(sqrt(I(:,:,1)));
+%! Od = AlterMin(I,[No,No],Ns,opts);
+%! opts.Iscale = Iscale;
+%! Oq = AlterMin(Iq,[No,No],Ns,opts);
+%! assert(norm(Oq(:)-Od(:))/norm(Od(:)) < 1e-3);
@@ -0,0 +1,63 @@
+function [ O, P, err, scale, Ns ] = AlterMin_Refine( I, prev, replaced, opts )
+%ALTERMIN_REFINE refine a previous AlterMin result after some frames were
+%reacquired, instead of rerunning the reconstruction from scratch
+%   Outputs: same as AlterMin, err holds the errors of both stages
+%
+%   Inputs:
+%   I: intensity measurements, with the reacquired frames already replaced
+%   prev: previous result as saved by main.m, with fields O, P, err_pc, c
+%   and Ns_cal
+%   replaced: indices into I of the reacquired frames
+%   opts: AlterMin options of the original run, plus
+%   refineIter: passes over the local subset (default 3)
+%
+% Stage 1 runs AlterMin only on the replaced frames and their k-space
+% neighbours, i.e. the frames whose crop windows share at least half their
+% area with a replaced frame's window. Stage 2 runs over all frames and stops as soon
+% as the error is back at the level of the previous result.
+
+if ~isfield(opts,'refineIter')
+    opts.refineIter = 3;
+end
+
+Np = [size(I,1),size(I,2)];
+No = size(prev.O);
+Ns = prev.Ns_cal;
+k = reshape(Ns(1,:,:),[],2);
+
+subset = false(size(k,1),1);
+for r = replaced(:).'
+    % shared area of two Np windows offset by dk is prod(1-|dk|./Np)
+    subset = subset | prod(max(0,1-abs(k-k(r,:))./Np),2) >= 0.5;
+end
+fprintf('refining %d replaced frames with %d k-space neighbours\n',...
+    numel(replaced),sum(subset)-numel(replaced));
+
+% AlterMin returns O in real space, the fourier mode iterates on its spectrum
+if strcmp(opts.mode,'fourier')
+    toO0 = opts.F;
+else
+    toO0 = @(x) x;
+end
+
+% stage 1: replaced frames and their neighbours
+opts1 = opts;
+opts1.O0 = toO0(prev.O);
+opts1.P0 = prev.P;
+opts1.scale = prev.c(:);
+opts1.imgSubset = find(subset);
+opts1.maxIter = opts.refineIter;
+opts1.errTarget = 0;
+[O,P,err1,scale,Ns] = AlterMin(I,No,Ns,opts1);
+
+% stage 2: all frames until the error is back to its previous level
+opts.O0 = toO0(O);
+opts.P0 = P;
+opts.scale = scale(:);
+opts.imgSubset = 1:size(I,3);
+opts.errTarget = prev.err_pc(end);
+[O,P,err2,scale,Ns] = AlterMin(I,No,Ns,opts);
+
+err = [err1,err2];
+
+end
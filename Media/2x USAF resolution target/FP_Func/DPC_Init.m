@@ -0,0 +1,96 @@
+function [ O0, phi ] = DPC_Init( I, Ns, P, No, F, Ft, reg, Iscale )
+%DPC_INIT initial guess for AlterMin from a differential phase contrast
+%estimate over the brightfield frames, instead of the center-LED amplitude
+%with flat phase
+%   Outputs:
+%   O0: initial object spectrum on the No grid, same format as
+%   padarray(F(sqrt(I(:,:,1))),(No-Np)/2) used so far
+%   phi: low-resolution phase estimate, Np x Np
+%
+%   Inputs:
+%   I: intensity measurements, background subtracted (Np x Np x Nimg)
+%   Ns: LED spectrum shifts, same as passed to AlterMin (1 x Nimg x 2)
+%   P: pupil, e.g. w_NA
+%   No = [Ny_obj,Nx_obj]: size of the reconstructed image
+%   F, Ft: operators of Fourier transform and inverse
+%   reg: Tikhonov regularization (default 1e-1)
+%   Iscale: per-frame factor from the stored values of I to intensity, as
+%   in AlterMin (default 1)
+%
+% Under the weak object approximation o = exp(mu+i*phi), a brightfield
+% frame lit with spectrum shift k, normalized to I/mean(I)-1, has the
+% spectrum
+%   Ha(v)*mu(v) + Hp(v)*phi(v),  Ha = P(v+k)+P(k-v),  Hp = i*[P(v+k)-P(k-v)]
+% so mu and phi follow from one 2x2 least squares solve per frequency over
+% all brightfield frames. The amplitude of O0 is the root of the mean
+% brightfield frame.
+
+if nargin < 7
+    reg = 1e-1;
+end
+if nargin < 8
+    Iscale = ones(1,size(I,3));
+end
+if size(Ns,1) > 1
+    error('DPC_Init: only single-LED patterns are supported');
+end
+
+[n1,n2,Nimg] = size(I);
+c = round(([n1,n2]+1)/2);
+P = double(P ~= 0);
+
+% Q(v) = P(-v) about the center pixel
+Q = zeros(n1,n2);
+ri = 2*c(1)-(1:n1); rv = ri>=1 & ri<=n1;
+ci = 2*c(2)-(1:n2); cv = ci>=1 & ci<=n2;
+Q(rv,cv) = P(ri(rv),ci(cv));
+
+A11 = 0; A12 = 0; A22 = 0; b1 = 0; b2 = 0;
+Ibf = 0;
+nbf = 0;
+for m = 1:Nimg
+    k = [Ns(1,m,1),Ns(1,m,2)];
+    % brightfield frames only, the unscattered light passes the pupil
+    if any(abs(k) >= c-1) || P(c(1)+k(1),c(2)+k(2)) == 0
+        continue;
+    end
+    Im = double(I(:,:,m))*Iscale(m);
+    Ibf = Ibf+Im;
+    nbf = nbf+1;
+
+    Pp = Shift_Pupil(P,k);   % P(v+k)
+    Pm = Shift_Pupil(Q,-k);  % P(k-v)
+    Ha = Pp+Pm;
+    Hp = 1i*(Pp-Pm);
+    In = F(Im/mean(Im(:))-1);
+
+    A11 = A11+abs(Ha).^2;
+    A12 = A12+conj(Ha).*Hp;
+    A22 = A22+abs(Hp).^2;
+    b1 = b1+conj(Ha).*In;
+    b2 = b2+conj(Hp).*In;
+end
+if nbf == 0
+    error('DPC_Init: no brightfield frames');
+end
+fprintf('DPC initialization from %d brightfield frames\n',nbf);
+
+A11 = A11+reg;
+A22 = A22+reg;
+phi_hat = (A11.*b2-conj(A12).*b1)./(A11.*A22-abs(A12).^2);
+phi_hat(c(1),c(2)) = 0;
+phi = real(Ft(phi_hat));
+
+o = sqrt(max(Ibf/nbf,0)).*exp(1i*phi);
+O0 = padarray(F(o),(No-[n1,n2])/2);
+
+end
+
+function Ps = Shift_Pupil(P,s)
+% Ps(v) = P(v+s), zero where v+s leaves the grid
+[n1,n2] = size(P);
+Ps = zeros(n1,n2);
+r = max(1,1-s(1)):min(n1,n1-s(1));
+c = max(1,1-s(2)):min(n2,n2-s(2));
+Ps(r,c) = P(r+s(1),c+s(2));
+end
@@ -0,0 +1,107 @@
+function [ geo ] = Estimate_LED_Geometry( Iall, roi, hhled, vvled, Litidx, good, ds_led, geo0, NA, lambda, du )
+%ESTIMATE_LED_GEOMETRY fit the LED array position, rotation and distance
+%from the brightfield frames, before reconstruction
+%   Outputs:
+%   geo.led_offset = [v,h]: optical axis position on the array relative to
+%   lit_cenv/lit_cenh, in LEDs
+%   geo.led_rot: in-plane rotation of the array in rad
+%   geo.z_led: array to object distance
+%   geo.resid: rms misfit of the measured spectrum shifts in pixels
+%   geo.nused: number of frames in the fit
+%
+%   Inputs:
+%   Iall: frames in Litidx order
+%   roi = [r1,r2,c1,c2]: Np x Np region, the same crop as the reconstruction
+%   hhled, vvled: LED grid coordinates relative to lit_cenh/lit_cenv
+%   Litidx: LED of each frame
+%   good: false for frames to leave out (dropped video frames)
+%   ds_led: LED pitch
+%   geo0: current guess with fields led_offset, led_rot, z_led, used to
+%   pick the brightfield frames and the sign of each shift
+%   NA, lambda: objective NA and wavelength
+%   du: spectrum pixel size of an Np x Np crop
+%
+% A brightfield frame lit with spectrum shift k carries the object spectrum
+% inside two pupil disks centered at +k and -k, so the log spectrum has a
+% ring edge of radius NA/lambda around both. Correlating its edge map with
+% a ring finds |k| up to sign, the sign comes from the current guess.
+%
+% With t = the tangents of the illumination angles, a flat array gives
+%   -t = a*R(rot)*(g-offset),  a = ds_led/z_led
+% for LED grid position g, which is linear in [a*cos(rot), a*sin(rot)] and
+% the translation, so all frames are fitted in one least squares solve.
+% The LED pitch and z_led only enter through their ratio, so ds_led is
+% taken as exact and the scale is reported as z_led.
+
+n = roi(2)-roi(1)+1;
+c = floor(n/2)+1;
+r_na = NA/lambda/du;
+win = hanning(n)*hanning(n).';
+
+% ring template and search region, both centered at c
+[xx,yy] = meshgrid((1:n)-c);
+rr = hypot(xx,yy);
+ring = double(abs(rr-r_na) < 1);
+Fring = conj(fft2(ifftshift(ring)));
+search = rr < 1.05*r_na;
+
+[sv0,sh0] = LED_Angles(hhled,vvled,ds_led,geo0.z_led,geo0.led_offset,geo0.led_rot);
+k0 = [sv0(Litidx(:)),sh0(Litidx(:))]/lambda/du;
+bf = find(hypot(k0(:,1),k0(:,2)) < 0.85*r_na & good(:));
+
+kb = zeros(numel(bf),2);
+for q = 1:numel(bf)
+    m = bf(q);
+    x = double(Iall(roi(1):roi(2),roi(3):roi(4),m));
+    S = log(abs(fftshift(fft2(win.*(x-mean(x(:))))))+1);
+    S = conv2(S,fspecial('gaussian',7,1.5),'same');
+    [gx,gy] = gradient(S);
+    E = hypot(gx,gy);
+    C = fftshift(real(ifft2(fft2(ifftshift(E)).*Fring)));
+    C(~search) = -inf;
+    [~,k] = max(C(:));
+    [i,j] = ind2sub([n,n],k);
+    km = [i,j]-c;
+    if km*k0(m,:).' < 0
+        km = -km;
+    end
+    kb(q,:) = km;
+end
+kmeas = nan(numel(Litidx),2);
+kmeas(bf,:) = kb;
+
+% tangents of the measured illumination angles
+ok = ~isnan(kmeas(:,1));
+s = kmeas*lambda*du;
+t = s./sqrt(1-sum(s.^2,2));
+g = [hhled(Litidx(:)),vvled(Litidx(:))];
+
+% -t_v = al*g_h - be*g_v + b1,  -t_h = be*g_h + al*g_v + b2
+for pass = 1:2
+    nb = sum(ok);
+    A = [g(ok,1),-g(ok,2),ones(nb,1),zeros(nb,1);...
+        g(ok,2),g(ok,1),zeros(nb,1),ones(nb,1)];
+    b = -[t(ok,1);t(ok,2)];
+    p = A\b;
+    res = reshape(A*p-b,[],2);
+    res = hypot(res(:,1),res(:,2))/(lambda*du);
+    if pass == 1
+        % drop frames whose ring was misdetected, then refit
+        idx = find(ok);
+        ok(idx(res > max(3*median(res),1))) = false;
+    end
+end
+
+a = hypot(p(1),p(2));
+geo.led_rot = atan2(p(2),p(1));
+geo.z_led = ds_led/a;
+Am = a*[cos(geo.led_rot),-sin(geo.led_rot);sin(geo.led_rot),cos(geo.led_rot)];
+dc = -Am\p(3:4);
+geo.led_offset = [dc(2),dc(1)];
+geo.resid = sqrt(mean(res.^2));
+geo.nused = sum(ok);
+
+fprintf('LED geometry from %d brightfield frames: offset [%.2f,%.2f] LEDs, rotation %.2f deg, z_led %.0f, rms %.2f px\n',...
+    geo.nused,geo.led_offset(1),geo.led_offset(2),geo.led_rot*180/pi,geo.z_led,geo.resid);
+
+end
@@ -0,0 +1,61 @@
+function [ N_obj, plan ] = FFT_Size_Plan( N_min, Np, ncand )
+%FFT_SIZE_PLAN pick the reconstruction size N_obj as the smallest
+%2/3/5-smooth size that holds the synthetic aperture, instead of rounding
+%up to a multiple of Np
+%   Outputs:
+%   N_obj: chosen object size, >= N_min and with the same parity as Np so
+%   the initial guess can be zero-padded symmetrically in the Fourier domain
+%   plan: ncand x 3 table [N, relative 2-D FFT cost, largest prime factor],
+%   first row is the old multiple-of-Np size for reference
+%
+%   Inputs:
+%   N_min: smallest size covering the synthetic aperture
+%   Np: measurement patch size
+%   ncand: number of smooth candidates listed (default 4)
+%
+% Cost model: a mixed radix transform of length N takes about N*sum(p)
+% operations over the prime factors p of N, so a 2-D N x N transform
+% costs 2*N^2*sum(p). Sizes with a prime factor above 5 fall back to slow
+% generic FFTW kernels.
+
+if nargin < 3
+    ncand = 4;
+end
+
+fftcost = @(n) 2*n^2*sum(factor(n));
+smooth = @(n) max(factor(n)) <= 5;
+
+if ~smooth(Np)
+    lo = Np-1;
+    while ~smooth(lo)
+        lo = lo-1;
+    end
+    hi = Np+1;
+    while ~smooth(hi)
+        hi = hi+1;
+    end
+    fprintf('Np = %d has prime factor %d, consider Np = %d or %d\n',Np,max(factor(Np)),lo,hi);
+end
+
+N_old = ceil(N_min/Np)*Np;
+plan = [N_old,fftcost(N_old),max(factor(N_old))];
+
+n = max(N_min,Np);
+if mod(n-Np,2) ~= 0
+    n = n+1;
+end
+while size(plan,1) < ncand+1
+    if smooth(n)
+        plan(end+1,:) = [n,fftcost(n),max(factor(n))];
+    end
+    n = n+2;
+end
+plan(:,2) = plan(:,2)/plan(1,2);
+N_obj = plan(2,1);
+
+fprintf('|  N_obj | FFT cost | max prime |\n');
+fprintf('| %6d |   %5.2f  |   %4d    | multiple of Np\n',plan(1,:));
+fprintf('| %6d |   %5.2f  |   %4d    |\n',plan(2:end,:).');
+fprintf('using N_obj = %d\n',N_obj);
+
+end
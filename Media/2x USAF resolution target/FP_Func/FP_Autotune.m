@@ -0,0 +1,131 @@
+function [ cfg ] = FP_Autotune( Np, N_obj, Nimg, wisdomfile, retune, single_tol )
+%FP_AUTOTUNE pick FFT threads, FFTW planner and precision for this machine
+%and problem size, from short timed AlterMin trials, and remember them
+%   Outputs:
+%   cfg: fft_threads, planner, precision and the measured seconds per
+%   full pass (sec_per_pass). The settings are already applied to fftw
+%
+%   Inputs:
+%   Np, N_obj, Nimg: size of the reconstruction to tune for
+%   wisdomfile: .mat holding the tuned settings and FFTW wisdom of every
+%   machine and size class tuned so far
+%   retune: 1 = run the trials again even if this entry exists (default 0)
+%   single_tol: largest relative error of the single precision O against
+%   the double trial with the same threads and planner for single to be
+%   accepted (default 1e-3)
+%
+% Entries are keyed by host name, core count and size class (Np and N_obj
+% rounded up to a power of 2), so one file serves the acquisition laptop
+% and the render box. The trials run 2 passes over up to 10 synthetic
+% frames with random LED shifts, timing only the second one, for every
+% combination of thread count, 'estimate'/'measure' planning and
+% double/single precision. Single is only a candidate when its O stays
+% within single_tol of the double one, so it is never picked on speed
+% alone. The FFTW wisdom gathered is stored with the entry so later runs
+% skip planning.
+
+if nargin < 5
+    retune = 0;
+end
+if nargin < 6
+    single_tol = 1e-3;
+end
+
+key = sprintf('%s_n%d_Np%d_No%d',regexprep(gethostname(),'\W','_'),nproc,2^nextpow2(Np),2^nextpow2(N_obj));
+key = ['m_',key];
+tune = struct();
+if exist(wisdomfile,'file')
+    tune = load(wisdomfile);
+end
+
+if isfield(tune,key) && ~retune
+    cfg = tune.(key);
+    Apply_Config(cfg);
+    fprintf('autotune: using %s from %s\n',key,wisdomfile);
+    return;
+end
+
+%% synthetic problem of the same size
+ntrial = min(Nimg,10);
+I = rand(Np,Np,ntrial)*1e3;
+m = (0:Np-1)-round((Np+1)/2)+1;
+[mm,nn] = meshgrid(m);
+w_NA = double(hypot(mm,nn) < Np/4);
+Ns = zeros(1,ntrial,2);
+Ns(1,:,:) = round((rand(ntrial,2)-0.5)*(N_obj-Np)*0.8);
+
+opts.tol = -1;
+opts.maxIter = 2;
+opts.minIter = 2;
+opts.monotone = 0;
+opts.display = 0;
+opts.mode = 'fourier';
+opts.P0 = w_NA;
+opts.Ps = w_NA;
+opts.scale = ones(ntrial,1);
+opts.OP_alpha = 1;
+opts.OP_beta = 1e3;
+opts.poscalibrate = 0;
+opts.StepSize = 0.1;
+opts.F = @(x) fftshift(fft2(x));
+opts.Ft = @(x) ifft2(ifftshift(x));
+
+threads = unique(max(1,round(nproc*[1/4,1/2,1])));
+planners = {'estimate','measure'};
+precisions = {'double','single'};
+
+fprintf('autotune: %d trials for %s\n',numel(threads)*numel(planners)*numel(precisions),key);
+fprintf('| threads | planner  | precision | s/pass | rel.err  |\n');
+best = inf;
+for th = threads
+    for pl = planners
+        for pr = precisions
+            c.fft_threads = th;
+            c.planner = pl{1};
+            c.precision = pr{1};
+            Apply_Config(c);
+            opts.fft_threads = th;
+            opts.precision = pr{1};
+            opts.O0 = padarray(opts.F(sqrt(I(:,:,1))),[(N_obj-Np)/2,(N_obj-Np)/2]);
+            evalc('AlterMin(I,[N_obj,N_obj],Ns,setfield(opts,''maxIter'',1));');  % plans the transforms
+            t0 = tic;
+            evalc('O = AlterMin(I,[N_obj,N_obj],Ns,opts);');
+            sec = toc(t0)/opts.maxIter*Nimg/ntrial;
+            % precisions runs double first, which is the reference
+            if strcmp(pr{1},'double')
+                O_ref = double(O);
+                relerr = 0;
+            else
+                relerr = norm(double(O(:))-O_ref(:))/norm(O_ref(:));
+            end
+            fprintf('| %7d | %-8s | %-9s | %6.2f | %.2e |\n',th,pl{1},pr{1},sec,relerr);
+            if relerr > single_tol
+                continue;
+            end
+            if sec < best
+                best = sec;
+                cfg = c;
+                cfg.sec_per_pass = sec;
+            end
+        end
+    end
+end
+
+Apply_Config(cfg);
+cfg.dwisdom = fftw('dwisdom');
+cfg.swisdom = fftw('swisdom');
+tune.(key) = cfg;
+save(wisdomfile,'-struct','tune');
+fprintf('autotune: %d threads, %s planner, %s precision, %.2f s per pass\n',...
+    cfg.fft_threads,cfg.planner,cfg.precision,cfg.sec_per_pass);
+
+end
+
+function Apply_Config(cfg)
+fftw('threads',cfg.fft_threads);
+fftw('planner',cfg.planner);
+if isfield(cfg,'dwisdom')
+    fftw('dwisdom',cfg.dwisdom);
+    fftw('swisdom',cfg.swisdom);
+end
+end
@@ -0,0 +1,203 @@
+function [ varargout ] = FP_Cache( cmd, varargin )
+%FP_CACHE content-addressed on-disk cache for the stages of main.m
+%   FP_Cache('config', dir, max_gb, by_content)
+%                                     set the cache folder ('' = off), its
+%                                     size limit and whether input files
+%                                     are keyed by content (default 0)
+%   key = FP_Cache('key', ...)        md5 key of any mix of numeric,
+%                                     logical, char, cell and struct inputs
+%   v = FP_Cache('version', p1, ...)  md5 of the .m files in each folder
+%                                     p, or of each .m file p, to put the
+%                                     code version into stage keys
+%   k = FP_Cache('files', names)      md5 of the path, size and date of
+%                                     the files in the cell array names,
+%                                     or of their contents if by_content
+%   [hit, data] = FP_Cache('get', key)
+%   FP_Cache('put', key, data)        data is a struct of stage outputs
+%
+% A stage's key is built from its inputs and the key of the stage before
+% it, so a rerun that changes only a later setting (display, output
+% format) finds every earlier stage cached and starts at the first one
+% that changed. Input files enter keys by path, size and modification
+% date, a stat per file; by_content reads every byte instead, for data
+% that is copied or touched between runs. With the cache off, 'key',
+% 'version' and 'files' return '' without hashing anything.
+% For a script, 'version' hashes only the code below its "configuration
+% settings above this line" marker, the settings enter the stage keys
+% themselves. Entries are stored as <key>.mat; an index with size and
+% last access time drives LRU eviction once the folder exceeds max_gb.
+
+persistent cdir max_bytes by_content
+if isempty(cdir)
+    cdir = '';
+    max_bytes = 0;
+    by_content = 0;
+end
+if isempty(cdir) && any(strcmp(cmd,{'key','version','files'}))
+    varargout{1} = '';
+    return;
+end
+
+switch cmd
+    case 'config'
+        cdir = varargin{1};
+        max_bytes = varargin{2}*2^30;
+        by_content = 0;
+        if numel(varargin) > 2
+            by_content = varargin{3};
+        end
+        if ~isempty(cdir) && ~exist(cdir,'dir')
+            mkdir(cdir);
+        end
+
+    case 'key'
+        varargout{1} = hash('md5',char(Serialize(varargin)));
+
+    case 'version'
+        txt = '';
+        for p = 1:numel(varargin)
+            if exist(varargin{p},'dir')
+                files = dir(fullfile(varargin{p},'*.m'));
+                for k = 1:numel(files)
+                    txt = [txt,fileread(fullfile(varargin{p},files(k).name))];
+                end
+            else
+                src = fileread(varargin{p});
+                k = strfind(src,'configuration settings above this line');
+                if ~isempty(k)
+                    src = src(k(1):end);
+                end
+                txt = [txt,src];
+            end
+        end
+        varargout{1} = hash('md5',txt);
+
+    case 'files'
+        names = varargin{1};
+        if ischar(names)
+            names = {names};
+        end
+        txt = '';
+        for k = 1:numel(names)
+            if isempty(names{k})
+                continue;
+            end
+            if ~by_content
+                info = dir(names{k});
+                if isempty(info)
+                    error('FP_Cache: cannot read %s',names{k});
+                end
+                txt = [txt,sprintf('%s;%d;%.6f;',names{k},info.bytes,info.datenum)];
+                continue;
+            end
+            % in 64 MB pieces, so a whole video is never held in memory
+            fid = fopen(names{k},'r');
+            if fid < 0
+                error('FP_Cache: cannot read %s',names{k});
+            end
+            while true
+                buf = fread(fid,2^26,'uint8=>char').';
+                if isempty(buf)
+                    break;
+                end
+                txt = [txt,hash('md5',buf)];
+            end
+            fclose(fid);
+        end
+        varargout{1} = hash('md5',txt);
+
+    case 'get'
+        varargout = {false,[]};
+        if isempty(cdir)
+            return;
+        end
+        fn = fullfile(cdir,[varargin{1},'.mat']);
+        if exist(fn,'file')
+            varargout = {true,load(fn)};
+            idx = Load_Index(cdir);
+            if isfield(idx,['k',varargin{1}])
+                idx.(['k',varargin{1}]).atime = now;
+                Save_Index(cdir,idx);
+            end
+        end
+
+    case 'put'
+        if isempty(cdir)
+            return;
+        end
+        key = varargin{1};
+        data = varargin{2};
+        fn = fullfile(cdir,[key,'.mat']);
+        save('-binary',fn,'-struct','data');
+        info = dir(fn);
+        if info.bytes > max_bytes
+            delete(fn);
+            fprintf('cache: %.1f GB entry exceeds the cache size, not kept\n',info.bytes/2^30);
+            return;
+        end
+        idx = Load_Index(cdir);
+        idx.(['k',key]) = struct('bytes',info.bytes,'atime',now);
+        idx = Evict(cdir,idx,max_bytes);
+        Save_Index(cdir,idx);
+end
+
+end
+
+function b = Serialize(x)
+% class, size and raw bytes of x, recursing into cells and structs
+if iscell(x)
+    b = uint8(sprintf('cell%s;',mat2str(size(x))));
+    for k = 1:numel(x)
+        b = [b,Serialize(x{k})];
+    end
+elseif isstruct(x)
+    f = sort(fieldnames(x));
+    b = uint8(sprintf('struct%s;',mat2str(size(x))));
+    for k = 1:numel(f)
+        b = [b,uint8(f{k}),Serialize({x.(f{k})})];
+    end
+elseif ischar(x)
+    b = [uint8(sprintf('char%s;',mat2str(size(x)))),uint8(x(:).')];
+elseif isa(x,'function_handle')
+    b = uint8(['fh;',func2str(x)]);
+else
+    if islogical(x)
+        x = uint8(x);
+    end
+    if iscomplex(x)
+        x = [real(x(:));imag(x(:))];
+    end
+    b = [uint8(sprintf('%s%s;',class(x),mat2str(size(x)))),typecast(x(:).','uint8')];
+end
+end
+
+function idx = Load_Index(cdir)
+idx = struct();
+fn = fullfile(cdir,'index.mat');
+if exist(fn,'file')
+    idx = load(fn);
+end
+end
+
+function Save_Index(cdir,idx)
+save(fullfile(cdir,'index.mat'),'-struct','idx');
+end
+
+function idx = Evict(cdir,idx,max_bytes)
+% drop least recently used entries until the cache fits
+keys = fieldnames(idx);
+bytes = cellfun(@(k) idx.(k).bytes,keys);
+atime = cellfun(@(k) idx.(k).atime,keys);
+[~,order] = sort(atime);
+k = 1;
+while sum(bytes) > max_bytes && k <= numel(order)
+    j = order(k);
+    fn = fullfile(cdir,[keys{j}(2:end),'.mat']);
+    if exist(fn,'file')
+        delete(fn);
+    end
+    idx = rmfield(idx,keys{j});
+    bytes(j) = 0;
+    k = k+1;
+end
+end
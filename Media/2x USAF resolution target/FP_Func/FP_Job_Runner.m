@@ -0,0 +1,182 @@
+function FP_Job_Runner( jobdir, opts )
+%FP_JOB_RUNNER run queued reconstruction jobs in the background, as many
+%at a time as the memory and core budgets allow
+%   Inputs:
+%   jobdir: job directory, with queue/, running/, done/ and failed/
+%   subfolders (created if missing)
+%   opts:
+%   main_dir: folder holding main.m (default: current folder)
+%   ram_gb: memory budget (default: 80% of the available memory)
+%   cores: core budget (default nproc)
+%   threads_per_job: FFT threads given to each job (default 2)
+%   poll: seconds between queue scans (default 2)
+%   once: 1 = return when the queue is empty and all jobs are finished
+%
+% A job is a .m file dropped into queue/. It holds settings overriding the
+% top of main.m, e.g.
+%   filedir = '/data/scan_0412/'; out_dir = '/data/scan_0412/results';
+%   Np = 400; tiles = 1;
+%   job_priority = 5;   % higher runs first (default 0)
+%   N_obj_est = 1600;   % for the memory estimate (default 4*Np)
+% The acquisition side only has to write this file at the end of a scan.
+%
+% Each job runs as its own octave process on main.m, with its output in
+% running/<job>.log. Jobs are started in priority order whenever their
+% estimated peak memory and threads fit what the running jobs leave free.
+% On exit, the job file and log are moved to done/ or failed/ and a
+% <job>.status file records the exit code. Creating <job>.cancel next to a
+% queued or running job cancels it.
+
+if nargin < 2
+    opts = struct();
+end
+if ~isfield(opts,'main_dir')
+    opts.main_dir = pwd;
+end
+if ~isfield(opts,'ram_gb')
+    opts.ram_gb = 0.8*Available_RAM_GB();
+end
+if ~isfield(opts,'cores')
+    opts.cores = nproc;
+end
+if ~isfield(opts,'threads_per_job')
+    opts.threads_per_job = 2;
+end
+if ~isfield(opts,'poll')
+    opts.poll = 2;
+end
+if ~isfield(opts,'once')
+    opts.once = 0;
+end
+
+sub = {'queue','running','done','failed'};
+for k = 1:numel(sub)
+    if ~exist(fullfile(jobdir,sub{k}),'dir')
+        mkdir(fullfile(jobdir,sub{k}));
+    end
+end
+fprintf('job runner on %s: %.1f GB, %d cores\n',jobdir,opts.ram_gb,opts.cores);
+
+running = struct('name',{},'pid',{},'gb',{},'threads',{},'t0',{});
+while true
+    %% finished and cancelled jobs
+    for k = numel(running):-1:1
+        job = running(k);
+        status = [];
+        if exist(fullfile(jobdir,'running',[job.name,'.cancel']),'file')
+            kill(job.pid,15);
+            waitpid(job.pid);
+            status = -1;
+            delete(fullfile(jobdir,'running',[job.name,'.cancel']));
+        else
+            [pid,st] = waitpid(job.pid,WNOHANG);
+            if pid == job.pid
+                status = WEXITSTATUS(st);
+            end
+        end
+        if ~isempty(status)
+            Finish_Job(jobdir,job,status);
+            running(k) = [];
+        end
+    end
+
+    %% start queued jobs that fit
+    queued = dir(fullfile(jobdir,'queue','*.m'));
+    est = struct('name',{},'gb',{},'priority',{},'t',{});
+    for k = 1:numel(queued)
+        [~,name] = fileparts(queued(k).name);
+        jobfile = fullfile(jobdir,'queue',queued(k).name);
+        if exist(fullfile(jobdir,'queue',[name,'.cancel']),'file')
+            movefile(jobfile,fullfile(jobdir,'failed'));
+            delete(fullfile(jobdir,'queue',[name,'.cancel']));
+            fprintf('job %s cancelled before start\n',name);
+            continue;
+        end
+        [gb,priority] = Estimate_Job(jobfile);
+        est(end+1) = struct('name',name,'gb',gb,'priority',priority,'t',queued(k).datenum);
+    end
+    if ~isempty(est)
+        [~,order] = sortrows([-[est.priority].',[est.t].']);
+        est = est(order);
+    end
+    for k = 1:numel(est)
+        used_gb = sum([running.gb]);
+        used_cores = sum([running.threads]);
+        fits = used_gb+est(k).gb <= opts.ram_gb && used_cores+opts.threads_per_job <= opts.cores;
+        if ~fits && ~isempty(running)
+            continue;
+        end
+        if ~fits
+            fprintf('job %s needs %.1f GB, over the %.1f GB budget, running it alone\n',...
+                est(k).name,est(k).gb,opts.ram_gb);
+        end
+        running(end+1) = Start_Job(jobdir,est(k),opts);
+    end
+
+    if opts.once && isempty(running) && isempty(dir(fullfile(jobdir,'queue','*.m')))
+        break;
+    end
+    pause(opts.poll);
+end
+
+end
+
+function job = Start_Job(jobdir,est,opts)
+% copy the job to running/ with the runner's settings appended, then start
+% octave on main.m with it
+src = fullfile(jobdir,'queue',[est.name,'.m']);
+jobfile = fullfile(jobdir,'running',[est.name,'.m']);
+txt = fileread(src);
+fid = fopen(jobfile,'w');
+fprintf(fid,'recon_display = 0;\n%s\nfft_threads = %d;\nautotune_file = '''';\n',txt,opts.threads_per_job);
+fclose(fid);
+delete(src);
+
+logfile = fullfile(jobdir,'running',[est.name,'.log']);
+cmd = sprintf('exec octave --no-gui --quiet --eval "cd(''%s''); fp_job = ''%s''; main" > "%s" 2>&1',...
+    opts.main_dir,make_absolute_filename(jobfile),logfile);
+pid = system(cmd,false,'async');
+job = struct('name',est.name,'pid',pid,'gb',est.gb,'threads',opts.threads_per_job,'t0',clock);
+fprintf('job %s started (pid %d, est. %.1f GB)\n',est.name,pid,est.gb);
+end
+
+function Finish_Job(jobdir,job,status)
+if status == 0
+    dest = fullfile(jobdir,'done');
+else
+    dest = fullfile(jobdir,'failed');
+end
+movefile(fullfile(jobdir,'running',[job.name,'.*']),dest);
+fid = fopen(fullfile(dest,[job.name,'.status']),'w');
+fprintf(fid,'exit = %d\nelapsed = %.0f\n',status,etime(clock,job.t0));
+fclose(fid);
+fprintf('job %s finished with exit %d after %.0f s\n',job.name,status,etime(clock,job.t0));
+end
+
+function [gb,priority] = Estimate_Job(jobfile)
+% peak memory of main.m for a job: the loaded stack, the uint16 patch
+% stack I with its Iscale factors, the few double Np x Np arrays AlterMin
+% makes per visit and the object spectrum with its padded copies
+n1 = 3000; n2 = 3000; Np = 400; nbracket = 1;
+precision = 'double'; filedir = './data/';
+job_priority = 0; N_obj_est = [];
+eval(fileread(jobfile));
+if isempty(N_obj_est)
+    N_obj_est = 4*Np;
+end
+Nimg = max(1,numel(dir([filedir,'*.tif']))/nbracket);
+bytes = 8;
+if strcmp(precision,'single')
+    bytes = 4;
+end
+stack = n1*n2*Nimg*2*(1+(nbracket>1));
+patches = Np^2*Nimg*2+Nimg*8+4*Np^2*8;
+object = 4*N_obj_est^2*2*bytes;
+gb = (stack+patches+object)/2^30+0.5;  % + interpreter
+priority = job_priority;
+end
+
+function gb = Available_RAM_GB()
+[~,sys] = memory();
+gb = sys.PhysicalMemory.Available/2^30;
+end
@@ -25,10 +25,12 @@ n2 = n1+Np-1;
 downsamp = @(x) x(n1(1):n2(1),n1(2):n2(2));
 
 O1 = downsamp(O);
+aP = abs(P);
+aO1 = abs(O1);
 
-O(n1(1):n2(1),n1(2):n2(2)) = O(n1(1):n2(1),n1(2):n2(2))...
-    + step_size * 1/max(max(abs(P)))*abs(P).*conj(P).*dpsi./(abs(P).^2+alpha);
-P = P+1/Omax*(abs(O1).*conj(O1)).*dpsi./(abs(O1).^2+beta).*Ps;
+O(n1(1):n2(1),n1(2):n2(2)) = O1...
+    + step_size * 1/max(aP(:))*aP.*conj(P).*dpsi./(aP.^2+alpha);
+P = P+1/Omax*(aO1.*conj(O1)).*dpsi./(aO1.^2+beta).*Ps;
 
 end
 
@@ -0,0 +1,26 @@
+function [ acc, wsum ] = HDR_Merge_Frame( acc, wsum, frame, t, t_ref, sat_level, read_noise )
+%HDR_MERGE_FRAME accumulate one exposure of a bracket into a running
+%linear HDR estimate. Call once per file as it is read, then divide
+%acc./wsum after the last exposure of the bracket.
+%   Inputs:
+%   acc, wsum: running weighted sum and weight sum (0 for the first frame)
+%   frame: raw frame in camera counts
+%   t: exposure (pulse width) of this frame
+%   t_ref: exposure the merged frame is normalized to, so the result stays
+%   in the same counts as a single t_ref exposure
+%   sat_level: counts at or above this value are treated as saturated
+%   read_noise: camera read noise in counts
+%
+% Each pixel's radiance estimate frame*t_ref/t is weighted by its inverse
+% variance under a shot + read noise model, t^2/(frame+read_noise^2), so
+% long exposures dominate in the photon-starved darkfield and short ones
+% take over where the long ones saturate. Saturated pixels get zero weight;
+% eps keeps pixels saturated in every exposure finite.
+
+frame = double(frame);
+w = t^2./(max(frame,0)+read_noise^2).*(frame<sat_level)+eps;
+
+acc = acc+w.*frame*(t_ref/t);
+wsum = wsum+w;
+
+end
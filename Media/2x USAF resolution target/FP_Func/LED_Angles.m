@@ -0,0 +1,35 @@
+function [ sin_thetav, sin_thetah, dd ] = LED_Angles( hhled, vvled, ds_led, z_led, led_offset, led_rot, obj_pos )
+%LED_ANGLES illumination angles of the LEDs seen from a point on the object
+%   Outputs:
+%   sin_thetav, sin_thetah: direction sines of each LED, as used for the
+%   spectrum shifts (idx_v, idx_u) in main.m
+%   dd: LED to object distance
+%
+%   Inputs:
+%   hhled, vvled: LED grid coordinates relative to lit_cenh/lit_cenv, in LEDs
+%   ds_led: LED pitch
+%   z_led: distance from the LED array to the object
+%   led_offset = [v,h]: optical axis position on the array relative to
+%   lit_cenv/lit_cenh, in LEDs (from Estimate_LED_Geometry)
+%   led_rot: in-plane rotation of the array in rad
+%   obj_pos = [y,x]: point on the object, same units as ds_led (default [0,0])
+
+if nargin < 7
+    obj_pos = [0,0];
+end
+
+hg = hhled-led_offset(2);
+vg = vvled-led_offset(1);
+if led_rot ~= 0
+    hr = cos(led_rot)*hg-sin(led_rot)*vg;
+    vg = sin(led_rot)*hg+cos(led_rot)*vg;
+    hg = hr;
+end
+
+pv = -hg*ds_led+obj_pos(1);
+ph = -vg*ds_led+obj_pos(2);
+dd = sqrt(pv.^2+ph.^2+z_led.^2);
+sin_thetav = pv./dd;
+sin_thetah = ph./dd;
+
+end
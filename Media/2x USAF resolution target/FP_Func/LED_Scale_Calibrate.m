@@ -0,0 +1,75 @@
+function [ scale, bk ] = LED_Scale_Calibrate( files, isbf, cos_theta, roi, bracket )
+%LED_SCALE_CALIBRATE estimate per-LED brightness and background from a
+%calibration sweep over a blank slide (firmware K command)
+%   Outputs:
+%   scale: relative brightness of each LED at the sample, 1 for the LED
+%   closest to the optical axis. Same meaning as opts.scale in AlterMin
+%   bk: background (stray light + sensor offset) of each LED's frames
+%
+%   Inputs:
+%   files: calibration frames in acquisition order, one per LED, or one
+%   per exposure when the sweep ran with brackets (firmware CB command)
+%   isbf: true for brightfield LEDs (illumination NA < objective NA)
+%   cos_theta: cosine of each LED's illumination angle
+%   roi = [r1,r2,c1,c2]: region of the frame used for reconstruction
+%   bracket: exposure bracket of the sweep, fields exposure (pulse width of
+%   each exposure, same as bracket_exposure in main.m), sat_level and
+%   read_noise. Each LED's files are merged with HDR_Merge_Frame like the
+%   measurement frames (default: no bracketing)
+%
+% A blank slide passes no darkfield light into the objective, so darkfield
+% frames only measure the background. Brightfield frames measure the LED
+% directly; darkfield LED brightness is extrapolated from a cos(theta)^p
+% falloff fitted to the brightfield LEDs.
+
+if nargin < 5
+    bracket = struct('exposure',1,'sat_level',inf,'read_noise',0);
+end
+nbracket = numel(bracket.exposure);
+Nimg = numel(isbf);
+if numel(files) ~= Nimg*nbracket
+    error('LED_Scale_Calibrate: %d files for %d LEDs x %d exposures',numel(files),Nimg,nbracket);
+end
+
+v = zeros(Nimg,1);
+for m = 1:Nimg
+    if nbracket > 1
+        acc = 0; wsum = 0;
+        for b = 1:nbracket
+            Itmp = imread(files{(m-1)*nbracket+b});
+            [acc,wsum] = HDR_Merge_Frame(acc,wsum,Itmp(roi(1):roi(2),roi(3):roi(4)),...
+                bracket.exposure(b),bracket.exposure(1),bracket.sat_level,bracket.read_noise);
+        end
+        Itmp = acc./wsum;
+    else
+        Itmp = double(imread(files{m}));
+        Itmp = Itmp(roi(1):roi(2),roi(3):roi(4));
+    end
+    v(m) = mean2(Itmp);
+end
+
+isbf = isbf(:);
+cos_theta = cos_theta(:);
+
+% darkfield frames give the background, brightfield frames share its median
+bk = v;
+if any(~isbf)
+    bk(isbf) = median(v(~isbf));
+else
+    bk(isbf) = 0;
+end
+sig = max(v-bk,eps);
+
+% least squares fit of log(sig) = log(a)+p*log(cos_theta) on brightfield
+A = [ones(sum(isbf),1),log(cos_theta(isbf))];
+coef = A\log(sig(isbf));
+scale = sig;
+scale(~isbf) = exp(coef(1))*cos_theta(~isbf).^coef(2);
+
+[~,idx0] = max(cos_theta);
+scale = scale/scale(idx0);
+
+fprintf('LED calibration: falloff cos^%.2f, brightfield spread %.1f%%\n',...
+    coef(2),100*std(scale(isbf))/mean(scale(isbf)));
+
+end
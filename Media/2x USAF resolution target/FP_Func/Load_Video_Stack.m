@@ -0,0 +1,134 @@
+function [ Iall, good ] = Load_Video_Stack( videofile, logfile, n1, n2, Litidx, isbf, opts )
+%LOAD_VIDEO_STACK decode a video mode acquisition into one frame per LED,
+%aligned to the firmware frame log, without writing intermediate TIFFs
+%   Outputs:
+%   Iall: n1 x n2 x Nled uint16 stack in Litidx order, same as the TIFF loader
+%   good: Nled x 1, false for LEDs whose only frame was dropped
+%
+%   Inputs:
+%   videofile: movie recorded by the camera in video mode
+%   logfile: acquisitions/video_*.csv written by the controller
+%   (frame,step,x,y,edgeMicros,late, one row per firmware frame)
+%   n1, n2: frame size
+%   Litidx: linear indices of the LEDs used, into the LED grid
+%   isbf: LED grid, true for brightfield LEDs
+%   opts:
+%   threads: decoder threads, 0 lets ffmpeg use all cores (default 0)
+%   pix_fmt: ffmpeg output format, 16-bit mono (default 'gray16le')
+%   mixed_tol: top/bottom imbalance that marks a rolling shutter frame
+%   lit by two LEDs (default 0.2)
+%   ds: downsampling of the signature pass (default 8)
+%
+% Two ffmpeg passes are piped straight into Octave. The first one decodes
+% downsampled frames for the frame-mean signature, which gives the offset
+% between the video and the firmware frame numbers (frames recorded before
+% the sequence started) and the mixed frames. The second decodes full frames
+% and keeps only the ones mapped to an LED.
+
+if nargin < 7
+    opts = struct();
+end
+if ~isfield(opts,'threads')
+    opts.threads = 0;
+end
+if ~isfield(opts,'pix_fmt')
+    opts.pix_fmt = 'gray16le';
+end
+if ~isfield(opts,'mixed_tol')
+    opts.mixed_tol = 0.2;
+end
+if ~isfield(opts,'ds')
+    opts.ds = 8;
+end
+
+%% firmware frame log
+flog = dlmread(logfile,',',1,0);
+fnum = flog(:,1);
+ledx = flog(:,3);
+ledy = flog(:,4);
+tedge = flog(:,5);
+late = flog(:,6) ~= 0;
+nlog = numel(fnum);
+
+lin = sub2ind(size(isbf),ledy+1,ledx+1);
+[inlit,pos] = ismember(lin,Litidx);
+
+% frame i lasts from its edge to the next one, irregular spacing means a
+% missed or extra strobe around it
+dt = diff(tedge);
+irregular = false(nlog,1);
+irregular(2:end-1) = abs(dt(2:end)-median(dt)) > 0.5*median(dt);
+
+%% pass 1: downsampled frame-mean signature
+m1 = floor(n1/opts.ds);
+m2 = floor(n2/opts.ds);
+fid = popen(sprintf('ffmpeg -v error -threads %d -i "%s" -vf scale=%d:%d -f rawvideo -pix_fmt %s -',...
+    opts.threads,videofile,m2,m1,opts.pix_fmt),'r');
+vmean = [];
+vtop = [];
+vbot = [];
+third = floor(m1/3);
+while true
+    fr = fread(fid,[m2,m1],'uint16=>double');
+    if numel(fr) < m1*m2
+        break;
+    end
+    fr = fr.';
+    vmean(end+1) = mean(fr(:));
+    vtop(end+1) = mean2(fr(1:third,:));
+    vbot(end+1) = mean2(fr(end-third+1:end,:));
+end
+pclose(fid);
+nvid = numel(vmean);
+fprintf('decoded %d video frames for %d logged frames\n',nvid,nlog);
+if nvid < nlog
+    error('Load_Video_Stack: video has fewer frames than the firmware log');
+end
+
+% align the brightfield/darkfield pattern of the log to the frame means
+expected = double(isbf(lin));
+score = -inf(nvid-nlog+1,1);
+for o = 0:nvid-nlog
+    c = corrcoef(log(vmean(o+1:o+nlog).'+1),expected);
+    score(o+1) = c(1,2);
+end
+[~,offset] = max(score);
+offset = offset-1;
+fprintf('video frame offset %d\n',offset);
+
+% rolling shutter frames lit by two LEDs show a top/bottom imbalance, the
+% median frame mean keeps noise in dark frames from looking like one
+d = (vtop-vbot)./(vtop+vbot+median(vmean));
+mixed = abs(d-median(d)) > opts.mixed_tol;
+vidx = offset+fnum+1;
+drop = late | mixed(vidx).' | irregular;
+fprintf('dropping %d late, %d mixed and %d irregular frames\n',...
+    sum(late),sum(mixed(vidx)),sum(irregular));
+
+%% pass 2: full frames for the kept LEDs
+Nled = numel(Litidx);
+Iall = zeros(n1,n2,Nled,'uint16');
+good = false(Nled,1);
+keep = zeros(nvid,1);
+keep(vidx(inlit & ~drop)) = pos(inlit & ~drop);
+lastv = find(keep,1,'last');
+
+fid = popen(sprintf('ffmpeg -v error -threads %d -i "%s" -f rawvideo -pix_fmt %s -',...
+    opts.threads,videofile,opts.pix_fmt),'r');
+for v = 1:lastv
+    fr = fread(fid,[n2,n1],'uint16=>uint16');
+    if numel(fr) < n1*n2
+        break;
+    end
+    if keep(v) > 0 && ~good(keep(v))
+        Iall(:,:,keep(v)) = fr.';
+        good(keep(v)) = true;
+    end
+end
+pclose(fid);
+
+if any(~good)
+    fprintf('%d LEDs have no usable frame and will be left out\n',sum(~good));
+end
+
+end
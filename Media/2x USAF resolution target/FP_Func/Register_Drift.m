@@ -0,0 +1,102 @@
+function [ drift, drift_raw ] = Register_Drift( Iall, isbf, roi, opts )
+%REGISTER_DRIFT estimate the sample drift over the acquisition sequence
+%   Outputs:
+%   drift: Nimg x 2 [rows,cols] shift of each frame's content relative to
+%   the brightfield mean, smoothed over the acquisition order. Pass it to
+%   Shift_Crop to cut registered patches
+%   drift_raw: per-frame phase correlation estimate before smoothing (NaN
+%   for frames without a reliable correlation peak)
+%
+%   Inputs:
+%   Iall: frames in acquisition order (n1 x n2 x Nimg)
+%   isbf: Nimg x 1, true for brightfield frames
+%   roi = [r1,r2,c1,c2]: region used for registration
+%   opts:
+%   order: order of the polynomial drift model over time (default 3)
+%   minpeak: smallest correlation peak accepted (default 0.05)
+%
+% Brightfield frames are correlated on their intensity. Darkfield frames
+% only carry the scattering edges of the sample, so both they and the
+% reference are reduced to the band-passed gradient magnitude first.
+% Thermal drift is slow, so the per-frame estimates are fitted with a low
+% order polynomial in frame number, which also bridges frames whose peak
+% was too weak.
+
+if nargin < 4
+    opts = struct();
+end
+if ~isfield(opts,'order')
+    opts.order = 3;
+end
+if ~isfield(opts,'minpeak')
+    opts.minpeak = 0.05;
+end
+
+Nimg = size(Iall,3);
+isbf = isbf(:);
+n = [roi(2)-roi(1)+1,roi(4)-roi(3)+1];
+win = hanning(n(1))*hanning(n(2)).';
+
+ref = zeros(n);
+for m = find(isbf).'
+    ref = ref+double(Iall(roi(1):roi(2),roi(3):roi(4),m));
+end
+ref = ref/sum(isbf);
+Fref_bf = conj(fft2(win.*(ref-mean(ref(:)))));
+Fref_df = conj(fft2(win.*Edge_Map(ref)));
+
+drift_raw = nan(Nimg,2);
+for m = 1:Nimg
+    x = double(Iall(roi(1):roi(2),roi(3):roi(4),m));
+    if isbf(m)
+        R = fft2(win.*(x-mean(x(:)))).*Fref_bf;
+    else
+        R = fft2(win.*Edge_Map(x)).*Fref_df;
+    end
+    r = real(ifft2(R./(abs(R)+eps)));
+    [pk,k] = max(r(:));
+    if pk < opts.minpeak
+        continue;
+    end
+    [i,j] = ind2sub(n,k);
+    d = [Peak_Offset(r,i,j,1),Peak_Offset(r,i,j,2)]+[i,j]-1;
+    drift_raw(m,:) = mod(d+n/2,n)-n/2;
+end
+
+% smooth model over time, one reweighting pass drops outliers
+t = (1:Nimg).'/Nimg;
+V = t.^(0:opts.order);
+drift = zeros(Nimg,2);
+for k = 1:2
+    ok = ~isnan(drift_raw(:,k));
+    coef = V(ok,:)\drift_raw(ok,k);
+    res = abs(V*coef-drift_raw(:,k));
+    ok = ok & res <= max(3*median(res(ok)),0.5);
+    coef = V(ok,:)\drift_raw(ok,k);
+    drift(:,k) = V*coef;
+end
+
+fprintf('drift registration: %d of %d frames, max drift %.1f px\n',...
+    sum(~isnan(drift_raw(:,1))),Nimg,max(hypot(drift(:,1),drift(:,2))));
+
+end
+
+function e = Edge_Map(x)
+% band-passed gradient magnitude, mean removed
+k = fspecial('gaussian',9,2);
+x = conv2(log(x-min(x(:))+1),k,'same');
+[gx,gy] = gradient(x);
+e = hypot(gx,gy);
+e = e-mean(e(:));
+end
+
+function o = Peak_Offset(r,i,j,dim)
+% sub-pixel peak position along dim from a parabola through 3 samples
+n = size(r,dim);
+if dim == 1
+    a = r(mod(i-2,n)+1,j); b = r(i,j); c = r(mod(i,n)+1,j);
+else
+    a = r(i,mod(j-2,n)+1); b = r(i,j); c = r(i,mod(j,n)+1);
+end
+o = 0.5*(a-c)/(a-2*b+c+eps);
+end
@@ -0,0 +1,24 @@
+function [ x ] = Shift_Crop( frame, cen, Np, d )
+%SHIFT_CROP cut an Np x Np patch centered at cen out of a frame whose
+%content is shifted by d, so the patch lines up with the reference
+%   Inputs:
+%   frame: full frame
+%   cen = [row,col]: patch center, the patch is cen-Np/2 : cen+Np/2-1
+%   Np: patch size
+%   d = [rows,cols]: drift of this frame from Register_Drift
+%
+% The whole-pixel part of d moves the crop window (edge pixels repeat at
+% the frame border), the sub-pixel rest is a Fourier shift of the patch.
+
+di = round(d);
+df = d-di;
+r = min(max(cen(1)-Np/2+di(1)+(0:Np-1),1),size(frame,1));
+c = min(max(cen(2)-Np/2+di(2)+(0:Np-1),1),size(frame,2));
+x = double(frame(r,c));
+
+if any(df ~= 0)
+    k = ifftshift((0:Np-1)-floor(Np/2))/Np;
+    x = real(ifft2(fft2(x).*exp(1i*2*pi*(k.'*df(1)+k*df(2)))));
+end
+
+end
@@ -0,0 +1,122 @@
+function [ mosaic_size, g ] = Tile_Blend( files, tcen, Np, overlap, outfile )
+%TILE_BLEND stitch tile reconstructions into one mosaic without seams,
+%streaming it to disk instead of holding it in memory
+%   Outputs:
+%   mosaic_size = [rows,cols] of the mosaic written to outfile
+%   g: complex gain applied to each tile, exp(log-amplitude + i*phase)
+%
+%   Inputs:
+%   files: tile results saved by main.m (field O), in the order of tcen
+%   tcen: tile centers in frame pixels, from Tile_Schedule
+%   Np: tile size in frame pixels
+%   overlap: pixels shared by neighbouring tiles
+%   outfile: raw output, complex single interleaved (re,im), row by row
+%
+% Every tile comes out of AlterMin with its own global phase and a slightly
+% different amplitude scale. For each pair of overlapping tiles the overlap
+% gives the log-amplitude ratio and the phase difference; one least squares
+% solve over all pairs (first tile fixed) gives a gain per tile. Tiles are
+% then added in row order with linear feathering over the overlap, and rows
+% no later tile can reach are written out and dropped from the buffer.
+
+ntile = size(tcen,1);
+tmp = load(files{1});
+N = size(tmp.O,1);
+clear tmp
+up = N/Np;   % mosaic pixels per frame pixel, not an integer in general (FFT_Size_Plan)
+
+% tile offsets on the mosaic grid, rounded to whole mosaic pixels. The
+% placement error is at most half a mosaic pixel, the overlaps below are
+% taken from these rounded offsets so the pairs stay consistent
+T = round((tcen-Np/2-1)*up);
+
+%% pairwise offsets from the overlaps
+[pi_,pj_] = find(triu(abs(T(:,1)-T(:,1).') < N & abs(T(:,2)-T(:,2).') < N,1));
+npair = numel(pi_);
+% every tile is loaded once and only its overlap strips are kept, one
+% worker per tile when the parallel package is installed
+strip = @(t) Tile_Strips(files{t},t,T,N,pi_,pj_);
+if ~isempty(pkg('list','parallel'))
+    pkg load parallel
+    S = pararrayfun(nproc,strip,1:ntile,'UniformOutput',false);
+else
+    S = arrayfun(strip,1:ntile,'UniformOutput',false);
+end
+dlog = zeros(npair,1);
+dphi = zeros(npair,1);
+for q = 1:npair
+    oi = S{pi_(q)}{q};
+    oj = S{pj_(q)}{q};
+    dlog(q) = log(mean(abs(oj(:)))/mean(abs(oi(:))));
+    dphi(q) = angle(sum(oj(:).*conj(oi(:))));
+end
+clear S
+
+% a_i-a_j = dlog, p_i-p_j = dphi, a_1 = p_1 = 0
+A = sparse([1:npair,1:npair,npair+1],[pi_.',pj_.',1],[ones(1,npair),-ones(1,npair),1],npair+1,ntile);
+a = A\[dlog;0];
+p = A\[dphi;0];
+g = exp(a+1i*p);
+fprintf('tile gains: amplitude %.3f-%.3f, phase spread %.2f rad\n',...
+    min(abs(g)),max(abs(g)),max(p)-min(p));
+
+%% feathered blending, streamed in row order
+ov = max(1,round(overlap*up));
+ramp = min(1,(1:N)/(ov+1));
+ramp = min(ramp,fliplr(ramp));
+w = single(ramp.'*ramp);
+
+mosaic_size = [max(T(:,1)),max(T(:,2))]+N;
+W = mosaic_size(2);
+fid = fopen(outfile,'w');
+b0 = 1;  % mosaic row held in the first buffer row
+acc = zeros(0,W,'single');
+wsum = zeros(0,W,'single');
+[~,order] = sort(T(:,1));
+for t = order(:).'
+    % rows above this tile are complete
+    nflush = T(t,1)+1-b0;
+    if nflush > 0
+        Write_Rows(fid,acc(1:nflush,:)./max(wsum(1:nflush,:),eps('single')));
+        acc(1:nflush,:) = [];
+        wsum(1:nflush,:) = [];
+        b0 = b0+nflush;
+    end
+    need = T(t,1)+N-b0+1;
+    if size(acc,1) < need
+        acc(need,W) = 0;
+        wsum(need,W) = 0;
+    end
+
+    tmp = load(files{t});
+    r = T(t,1)+1-b0+(0:N-1);
+    c = T(t,2)+(1:N);
+    acc(r,c) = acc(r,c)+w.*single(g(t)*tmp.O);
+    wsum(r,c) = wsum(r,c)+w;
+    clear tmp
+end
+Write_Rows(fid,acc./max(wsum,eps('single')));
+fclose(fid);
+
+fprintf('mosaic %d x %d written to %s\n',mosaic_size(1),mosaic_size(2),outfile);
+
+end
+
+function s = Tile_Strips(file,t,T,N,pi_,pj_)
+% overlap of tile t with each of its pair partners, s{q} for pair q
+tmp = load(file);
+s = cell(numel(pi_),1);
+for q = find(pi_(:) == t | pj_(:) == t).'
+    i = pi_(q); j = pj_(q);
+    r = max(T(i,1),T(j,1))+1 : min(T(i,1),T(j,1))+N;
+    c = max(T(i,2),T(j,2))+1 : min(T(i,2),T(j,2))+N;
+    s{q} = tmp.O(r-T(t,1),c-T(t,2));
+end
+end
+
+function Write_Rows(fid,x)
+% rows in order, each as interleaved real/imag float32
+for k = 1:size(x,1)
+    fwrite(fid,[real(x(k,:));imag(x(k,:))],'float32');
+end
+end
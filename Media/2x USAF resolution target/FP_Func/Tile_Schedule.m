@@ -0,0 +1,36 @@
+function [ tcen ] = Tile_Schedule( n1, n2, Np, overlap )
+%TILE_SCHEDULE centers of the Np x Np tiles covering an n1 x n2 frame, in
+%the order they are reconstructed
+%   Outputs:
+%   tcen: ntile x 2 tile centers [row,col] in frame pixels. The crop of a
+%   tile is tcen-Np/2 : tcen+Np/2-1, same as the central patch
+%
+%   Inputs:
+%   n1, n2: frame size
+%   Np: tile size
+%   overlap: pixels shared by neighbouring tiles, for blending
+%
+% Tiles run from the frame center outward, ring by ring and around each
+% ring in angle, so every tile after the first has an already converged
+% neighbour to start from (see Tile_Seed).
+
+step = Np-overlap;
+r = Np/2+1 : step : n1-Np/2+1;
+c = Np/2+1 : step : n2-Np/2+1;
+% last row/column of tiles flush with the frame edge
+if r(end) < n1-Np/2+1
+    r(end+1) = n1-Np/2+1;
+end
+if c(end) < n2-Np/2+1
+    c(end+1) = n2-Np/2+1;
+end
+[cc,rr] = meshgrid(c,r);
+tcen = [rr(:),cc(:)];
+
+dr = (tcen(:,1)-n1/2)/step;
+dc = (tcen(:,2)-n2/2)/step;
+ring = round(max(abs(dr),abs(dc)));
+[~,order] = sortrows([ring,atan2(dr,dc),hypot(dr,dc)]);
+tcen = tcen(order,:);
+
+end
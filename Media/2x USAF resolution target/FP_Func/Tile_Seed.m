@@ -0,0 +1,43 @@
+function [ P0, scale0, dNs ] = Tile_Seed( cen, done_cen, tileP, tileScale, tileDNs, mode )
+%TILE_SEED warm start for a tile from the tiles already reconstructed
+%   Outputs:
+%   P0: initial pupil, the converged pupil of the nearest done tile
+%   scale0: initial LED brightness (Nimg x 1)
+%   dNs: correction added to the geometric LED spectrum shifts (Nimg x 2),
+%   rounded as AlterMin works on whole pixels
+%
+%   Inputs:
+%   cen: center of this tile [row,col]
+%   done_cen: centers of the done tiles (ndone x 2)
+%   tileP: converged pupils of the done tiles (cell)
+%   tileScale: converged scale of the done tiles (Nimg x ndone)
+%   tileDNs: converged shift corrections of the done tiles (Nimg x 2 x ndone),
+%   all zero unless AlterMin ran with poscalibrate, main.m then ignores dNs
+%   mode: 'nearest' copies scale and dNs from the nearest done tile,
+%   'plane' fits them as a plane over the field (from 3 done tiles on),
+%   which follows smooth field-dependent drift better
+%
+% Pupil aberrations, LED brightness and LED position errors vary slowly
+% across the field, so a neighbour's result is a much closer start than
+% w_NA, uniform scale and the geometric shifts.
+
+ndone = size(done_cen,1);
+d = hypot(done_cen(:,1)-cen(1),done_cen(:,2)-cen(2));
+[~,k] = min(d);
+P0 = tileP{k};
+
+if strcmp(mode,'plane') && ndone >= 3
+    A = [ones(ndone,1),done_cen];
+    a = [1,cen];
+    scale0 = (a*(A\tileScale.')).';
+    dNs = zeros(size(tileDNs,1),2);
+    for j = 1:2
+        dNs(:,j) = (a*(A\squeeze(tileDNs(:,j,:)).')).';
+    end
+    dNs = round(dNs);
+else
+    scale0 = tileScale(:,k);
+    dNs = tileDNs(:,:,k);
+end
+
+end
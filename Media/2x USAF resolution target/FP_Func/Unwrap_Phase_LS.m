@@ -0,0 +1,273 @@
+function [ phi, out_size ] = Unwrap_Phase_LS( src, opts )
+%UNWRAP_PHASE_LS least squares phase unwrapping of a reconstruction, in
+%memory or tile by tile over a mosaic on disk
+%   Outputs:
+%   phi: unwrapped phase in rad (empty when src is a mosaic file)
+%   out_size = [rows,cols] of the unwrapped phase
+%
+%   Inputs:
+%   src: complex object O, a wrapped phase map, or the file name of a raw
+%   complex float32 mosaic written by Tile_Blend
+%   opts:
+%   weighted: 1 = weight each pixel by |O| so low-amplitude, noisy regions
+%   do not pull the solution, 0 = unweighted (default 1 for complex src)
+%   maxit: iterations of the weighted solver (default 50)
+%   tol: relative residual the weighted solver stops at (default 1e-4)
+%   outfile: raw float32 output, row by row. '' = only return phi (default '')
+%   size = [rows,cols]: mosaic size, required when src is a file
+%   tile: tile size for mosaics (default 2048)
+%   overlap: pixels shared by neighbouring tiles (default 128)
+%   fft_threads: FFTW threads for the Poisson solves (default nproc)
+%
+% The unwrapped phase is the one whose gradient is closest in the least
+% squares sense to the wrapped differences of the input. Its normal
+% equations are a Poisson equation with Neumann boundaries, solved exactly
+% with one FFT pair over the mirrored 2M x 2N array (the same thing as a
+% DCT solve). The weighted problem (Ghiglia & Romero) is solved by
+% preconditioned conjugate gradients, each iteration preconditioned with the
+% unweighted FFT solve, which converges in a few tens of iterations.
+%
+% Mosaics are unwrapped in overlapping tiles. Each tile is only defined up
+% to a constant, so one least squares solve over the overlaps (first tile
+% fixed) aligns them, and the tiles are then feathered together and
+% streamed to outfile in row order like Tile_Blend.
+
+if nargin < 2
+    opts = struct();
+end
+if ~isfield(opts,'weighted')
+    opts.weighted = ischar(src) || ~isreal(src);
+end
+if ~isfield(opts,'maxit')
+    opts.maxit = 50;
+end
+if ~isfield(opts,'tol')
+    opts.tol = 1e-4;
+end
+if ~isfield(opts,'outfile')
+    opts.outfile = '';
+end
+if ~isfield(opts,'tile')
+    opts.tile = 2048;
+end
+if ~isfield(opts,'overlap')
+    opts.overlap = 128;
+end
+if ~isfield(opts,'fft_threads')
+    opts.fft_threads = nproc;
+end
+
+threads0 = fftw('threads');
+fftw('threads',opts.fft_threads);
+
+if ~ischar(src)
+    %% whole array in memory
+    if isreal(src)
+        phi = Unwrap_Block(src,[],opts);
+    elseif ~opts.weighted
+        phi = Unwrap_Block(angle(src),[],opts);
+    else
+        phi = Unwrap_Block(angle(src),abs(src),opts);
+    end
+    out_size = size(phi);
+    if ~isempty(opts.outfile)
+        fid = fopen(opts.outfile,'w');
+        fwrite(fid,phi.','float32');
+        fclose(fid);
+    end
+    fftw('threads',threads0);
+    return;
+end
+
+%% mosaic on disk, tile by tile
+out_size = opts.size;
+phi = [];
+M = out_size(1);
+W = out_size(2);
+N = min([opts.tile,M,W]);
+step = N-opts.overlap;
+r0 = unique([0:step:M-N,M-N]);
+c0 = unique([0:step:W-N,W-N]);
+[cc,rr] = meshgrid(c0,r0);
+T = [rr(:),cc(:)];
+ntile = size(T,1);
+
+% pass 1: unwrap each tile to a temporary file
+tmpfiles = cell(ntile,1);
+for t = 1:ntile
+    fid = fopen(src,'r');
+    z = Read_Block(fid,T(t,:),N,W);
+    fclose(fid);
+    if opts.weighted
+        p = Unwrap_Block(angle(z),abs(z),opts);
+    else
+        p = Unwrap_Block(angle(z),[],opts);
+    end
+    p = single(p);
+    tmpfiles{t} = [tempname(),'.mat'];
+    save('-binary',tmpfiles{t},'p');
+end
+
+% constant offset of each tile from the mean difference over its overlaps
+[pi_,pj_] = find(triu(abs(T(:,1)-T(:,1).') < N & abs(T(:,2)-T(:,2).') < N,1));
+npair = numel(pi_);
+dphi = zeros(npair,1);
+for q = 1:npair
+    i = pi_(q); j = pj_(q);
+    Pi = load(tmpfiles{i}); Pi = Pi.p;
+    Pj = load(tmpfiles{j}); Pj = Pj.p;
+    r = max(T(i,1),T(j,1))+1 : min(T(i,1),T(j,1))+N;
+    c = max(T(i,2),T(j,2))+1 : min(T(i,2),T(j,2))+N;
+    d = Pj(r-T(j,1),c-T(j,2))-Pi(r-T(i,1),c-T(i,2));
+    dphi(q) = mean(double(d(:)));
+end
+A = sparse([1:npair,1:npair,npair+1],[pi_.',pj_.',1],[ones(1,npair),-ones(1,npair),1],npair+1,ntile);
+% (p_i+off_i)-(p_j+off_j) = 0 over each overlap, i.e. off_i-off_j = dphi
+off = A\[dphi;0];
+
+% pass 2: feathered blending, streamed in row order
+ov = max(1,opts.overlap);
+ramp = min(1,(1:N)/(ov+1));
+ramp = min(ramp,fliplr(ramp));
+w = single(ramp.'*ramp);
+
+fid = fopen(opts.outfile,'w');
+b0 = 1;
+acc = zeros(0,W,'single');
+wsum = zeros(0,W,'single');
+[~,order] = sort(T(:,1));
+for t = order(:).'
+    nflush = T(t,1)+1-b0;
+    if nflush > 0
+        fwrite(fid,(acc(1:nflush,:)./max(wsum(1:nflush,:),eps('single'))).','float32');
+        acc(1:nflush,:) = [];
+        wsum(1:nflush,:) = [];
+        b0 = b0+nflush;
+    end
+    need = T(t,1)+N-b0+1;
+    if size(acc,1) < need
+        acc(need,W) = 0;
+        wsum(need,W) = 0;
+    end
+
+    tmp = load(tmpfiles{t});
+    r = T(t,1)+1-b0+(0:N-1);
+    c = T(t,2)+(1:N);
+    acc(r,c) = acc(r,c)+w.*(tmp.p+off(t));
+    wsum(r,c) = wsum(r,c)+w;
+    clear tmp
+    delete(tmpfiles{t});
+end
+fwrite(fid,(acc./max(wsum,eps('single'))).','float32');
+fclose(fid);
+fftw('threads',threads0);
+
+fprintf('unwrapped phase %d x %d (%d tiles) written to %s\n',M,W,ntile,opts.outfile);
+
+end
+
+function phi = Unwrap_Block(psi,amp,opts)
+% wrapped differences along columns (x) and rows (y), zero across the border
+wrap = @(x) mod(x+pi,2*pi)-pi;
+psi = double(psi);
+dx = [wrap(diff(psi,1,2)),zeros(size(psi,1),1)];
+dy = [wrap(diff(psi,1,1));zeros(1,size(psi,2))];
+
+if isempty(amp)
+    phi = Poisson_Solve(Div(dx,dy));
+    return;
+end
+
+% edge weights from the normalized amplitude of both end pixels
+q = double(amp)/max(double(amp(:))+eps);
+q = q.^2;
+wx = [min(q(:,1:end-1),q(:,2:end)),zeros(size(q,1),1)];
+wy = [min(q(1:end-1,:),q(2:end,:));zeros(1,size(q,2))];
+
+% PCG on -div(w grad phi) = -div(w d), preconditioned by the unweighted solve
+Aop = @(p) -Div(wx.*[diff(p,1,2),zeros(size(p,1),1)],wy.*[diff(p,1,1);zeros(1,size(p,2))]);
+b = -Div(wx.*dx,wy.*dy);
+nb = norm(b(:));
+phi = zeros(size(psi));
+if nb == 0
+    return;
+end
+r = b;
+z = -Poisson_Solve(r);
+p = z;
+rz = r(:).'*z(:);
+for k = 1:opts.maxit
+    Ap = Aop(p);
+    alpha = rz/(p(:).'*Ap(:));
+    phi = phi+alpha*p;
+    r = r-alpha*Ap;
+    if norm(r(:)) <= opts.tol*nb
+        break;
+    end
+    z = -Poisson_Solve(r);
+    rz1 = r(:).'*z(:);
+    p = z+(rz1/rz)*p;
+    rz = rz1;
+end
+phi = phi-mean(phi(:));
+end
+
+function rho = Div(gx,gy)
+% backward difference divergence, adjoint of the forward gradient above
+rho = gx-[zeros(size(gx,1),1),gx(:,1:end-1)]+gy-[zeros(1,size(gy,2));gy(1:end-1,:)];
+end
+
+function phi = Poisson_Solve(rho)
+% Neumann Poisson solve through the even extension of rho
+[M,N] = size(rho);
+re = [rho,fliplr(rho);flipud(rho),rot90(rho,2)];
+[kx,ky] = meshgrid(0:2*N-1,0:2*M-1);
+den = 2*cos(pi*kx/N)+2*cos(pi*ky/M)-4;
+den(1,1) = 1;
+R = fft2(re)./den;
+R(1,1) = 0;
+phi = real(ifft2(R));
+phi = phi(1:M,1:N);
+end
+
+function z = Read_Block(fid,t0,N,W)
+% N x N block at offset t0 = [row,col] from a raw interleaved complex float32 file
+z = zeros(N,N,'single');
+for k = 1:N
+    fseek(fid,8*((t0(1)+k-1)*W+t0(2)),'bof');
+    v = fread(fid,[2,N],'float32=>single');
+    z(k,:) = complex(v(1,:),v(2,:));
+end
+end
+
+%!function Write_Mosaic(fn,z)
+%! zz = z.';
+%! fid = fopen(fn,'w');
+%! fwrite(fid,[real(zz(:)).';imag(zz(:)).'],'float32');
+%! fclose(fid);
+%!endfunction
+
+%!function p = Read_Phase(fn,sz)
+%! fid = fopen(fn,'r');
+%! p = fread(fid,[sz(2),sz(1)],'float32').';
+%! fclose(fid);
+%!endfunction
+
+%!test
+%! % a ramp over many wraps unwrapped tile by tile matches the single block
+%! sz = [300,260];
+%! [x,y] = meshgrid(1:sz(2),1:sz(1));
+%! z = (1+0.5*cos(x/17)).*exp(1i*(0.21*x+0.13*y+2*sin(y/40)));
+%! src = [tempname(),'.raw'];
+%! dst = [tempname(),'.raw'];
+%! Write_Mosaic(src,z);
+%! for weighted = 0:1
+%!   ref = Unwrap_Phase_LS(single(z),struct('weighted',weighted,'fft_threads',1));
+%!   Unwrap_Phase_LS(src,struct('weighted',weighted,'fft_threads',1,'size',sz,...
+%!     'tile',128,'overlap',32,'outfile',dst));
+%!   p = Read_Phase(dst,sz);
+%!   d = (p-mean(p(:)))-(ref-mean(ref(:)));
+%!   assert(max(abs(d(:))) < 1e-2);
+%! end
+%! delete(src);
+%! delete(dst);
@@ -14,6 +14,8 @@ addpath(['./FP_Func']);
 addpath('./natsortfiles');
 
 loadimages = 1;  % 1 = load all the input images.   0 = assume images are already loaded to save time when iterating parameters
+videofile = '';  % movie from a video mode acquisition, decoded in place of the *.tif files in filedir. '' = load TIFFs
+videolog = '';  % acquisitions/video_*.csv frame log recorded by the controller for videofile
 imglist = dir([filedir,'*.tif']);  % Generate the image list
 N = natsortfiles({imglist.name});
 numlit = 1;  % define number of LEDs used to capture each image
@@ -33,12 +35,60 @@ dia_led = 30;   % 30 diameter of # of LEDs used in the experiment
 
 Ibk_thresh = 100;
 
+registerdrift = 0;  % 1 = estimate the sample drift over the acquisition and cut registered patches
+drift_roi = 512;  % size of the central region used for drift registration
+
+tiles = 0;  % 1 = reconstruct the whole frame in Np x Np tiles, 0 = only the central patch
+tile_overlap = 40;  % pixels shared by neighbouring tiles
+tile_seed = 'nearest';  % warm start of P, scale and LED shifts: 'nearest' done tile, or 'plane' fit over the field
+
+refine_frames = [];  % acquisition indices of reacquired frames. Non-empty = refine refine_result instead of reconstructing from scratch
+refine_result = '';  % previous result .mat saved by this script (O, P, err_pc, c, Ns_cal). Tiled runs refine each tile from its own -tileNN file next to it
+
+pos_calibrate = 0;  % AlterMin LED position correction (opts.poscalibrate): 0 = off, 'sa' or 'ga'. Tiled runs then seed each tile's LED shifts from its neighbours
+scale_update = 0;  % 1 = re-estimate each LED's brightness inside every AlterMin pass (opts.scaleUpdate)
+dpc_init = 0;  % 1 = start from a DPC phase estimate over the brightfield frames, 0 = center-LED amplitude with flat phase
+
+fft_threads = nproc;  % FFTW threads per 2-D transform. Large Np patches and the final N_obj inverse FFT are split across cores
+precision = 'double';  % 'double' or 'single' arithmetic in AlterMin
+frame_schedule = 'fixed';  % AlterMin frame order: 'fixed' = every frame once per iteration, 'residual' = most passes only over the frames with the largest residual, a full pass every opts.fullPassPeriod (maxIter counts all passes)
+autotune_file = './fp_autotune.mat';  % tuned threads/planner/precision per machine and size class, used in place of the two settings above when present. '' = off
+autotune = 0;  % 1 = (re)run the tuning trials for this machine and problem size
+
+cache_dir = '';  % cache of loaded frames, calibration, drift and reconstructions, e.g. './fp_cache/'. '' = off
+cache_gb = 20;  % cache size limit, least recently used entries are evicted beyond it
+cache_content_hash = 0;  % 1 = key input files by their contents instead of path, size and date, reads every frame on each run
+
+nbracket = 1;  % exposures per LED (firmware CB command). Files are grouped in bracket order and merged to one HDR frame per LED
+bracket_exposure = [100];  % pulse width of each bracket exposure, same order as the firmware. The merged frame is scaled to the first one
+sat_level = 65000;  % counts at or above this are treated as saturated when merging brackets
+read_noise = 3;  % camera read noise in counts, sets the noise weighting of short exposures
+
+calib_dir = './calib/';  % blank-slide frames from the firmware calibration sweep (K command), one per LED
+calib_profile = './led_profile.mat';  % per-LED brightness/background profile, loaded into opts.scale and Ibk when present
+runcalibration = 0;  % 1 = compute the profile from calib_dir and save it to calib_profile
+
 lit_cenv = 40;   % set up LED coordinates
 lit_cenh = 31;   %31
 vled = [0:63]-lit_cenv;
 hled = [0:63]-lit_cenh;
-
-
+led_offset = [0,0];  % [v,h] position of the optical axis on the array relative to lit_cenv/lit_cenh, in LEDs
+led_rot = 0;  % in-plane rotation of the LED array in rad
+estimate_geometry = 0;  % 1 = fit led_offset, led_rot and z_led to the brightfield frames before reconstructing
+
+unwrap_phase = 0;  % quantitative phase export as raw float32 (rad, row by row): 1 = least squares unwrapping, 2 = weighted by |O|, 0 = off
+unwrap_tile = 2048;  % tile size used when unwrapping a mosaic
+
+recon_display = 'full';  % AlterMin display: 'full', 'iter' or 0. Jobs from FP_Job_Runner run with 0
+
+% reconstruction job queued with FP_Job_Runner, its settings override the ones above
+if exist('fp_job','var') && ~isempty(fp_job)
+  eval(fileread(fp_job));
+  imglist = dir([filedir,'*.tif']);
+  N = natsortfiles({imglist.name});
+  vled = [0:63]-lit_cenv;
+  hled = [0:63]-lit_cenh;
+end
 
 
 % Most user inputs and configuration settings above this line
@@ -101,16 +151,62 @@ dpix_m = dpix_c/mag;  % effective image pixel size on the object plane
 FoV = Np*dpix_m;   % FoV in the object space
 
 
-if(loadimages == 1)
+% each stage is cached under a key of its inputs and the code version, a rerun starts at the first stage that changed
+% frames taken from the workspace (loadimages = 0) have no files to key on, so the cache is off for that run
+if ~isempty(cache_dir) && loadimages == 1
+  FP_Cache('config',cache_dir,cache_gb,cache_content_hash);
+else
+  FP_Cache('config','',0);
+end
+fp_version = FP_Cache('version','./FP_Func','./main.m');  % main.m counts from the configuration marker down
+if isempty(videofile)
+  datakey = FP_Cache('files',strcat(filedir,N));
+else
+  datakey = FP_Cache('files',{videofile,videolog});
+end
+key_load = FP_Cache('key','load',datakey,nbracket,bracket_exposure,sat_level,read_noise,...
+  n1,n2,Litidx,NA,ds_led,z_led,led_offset,led_rot,fp_version);  % '' with the cache off, nothing is hashed
+loaded = 0;
+if loadimages == 1
+  [loaded,st] = FP_Cache('get',key_load);
+  if loaded
+    Iall = st.Iall; Ibk = st.Ibk; led_good = st.led_good;
+    Nimg = size(Iall,3);
+    fprintf('images loaded from cache\n');
+  end
+  clear st
+end
+
+if(loadimages == 1 && isempty(videofile) && ~loaded)
   fprintf(['loading the images...\n']);
   tic;
-  Nimg = length(imglist);
-  Iall = zeros(n1,n2,Nimg,'uint16');
+  if mod(length(imglist),nbracket) ~= 0
+    error('%d files in %s do not split into brackets of %d exposures',length(imglist),filedir,nbracket);
+  end
+  Nimg = length(imglist)/nbracket;
+  if nbracket > 1
+    Iall = zeros(n1,n2,Nimg,'single');  % merged HDR frames exceed the 16-bit range
+  else
+    Iall = zeros(n1,n2,Nimg,'uint16');
+  end
   Ibk = zeros(Nimg,1);
+  led_good = true(Nimg,1);
   for m = 1:Nimg
+    if nbracket > 1
+      % merge the bracket as its files are read, only the merged frame is kept
+      acc = 0; wsum = 0;
+      for b = 1:nbracket
+        fn = [filedir,N{(m-1)*nbracket+b}];
+        disp(fn);
+        [acc,wsum] = HDR_Merge_Frame(acc,wsum,imread(fn),bracket_exposure(b),bracket_exposure(1),sat_level,read_noise);
+      end
+      Iall(:,:,m) = acc./wsum;
+      clear acc wsum
+    else
       fn = [filedir,N{m}];
       disp(fn);
       Iall(:,:,m) = double(imread(fn));  %Read 16-bit monochrome TIFF
+    end
       %tempI = double(imread(fn));
       %Iall(:,:,m) = double(imread(fn))(:,:,1);  %Read red channel from 48-bit color TIFF.
        %Iall(:,:,m) = transpose(downsample(transpose(downsample(tempI(:,:,1),2,1)),2,1));
@@ -147,25 +243,90 @@ clear m mm nn
 
 
 
-dd = sqrt((-hhled*ds_led).^2+(-vvled*ds_led).^2+z_led.^2);
-sin_thetav = (-hhled*ds_led)./dd;  % corresponding angles for each LEDs
-sin_thetah = (-vvled*ds_led)./dd;
+[sin_thetav,sin_thetah,dd] = LED_Angles(hhled,vvled,ds_led,z_led,led_offset,led_rot);  % corresponding angles for each LEDs
 illumination_na = sqrt(sin_thetav.^2+sin_thetah.^2);
 illumination_na_used = illumination_na(LitCoord);
 NBF = sum(illumination_na_used<NA);   % number of brightfield image
 
-vled = sin_thetav/lambda;  % corresponding spatial freq for each LEDs
-uled = sin_thetah/lambda;
+if(loadimages == 1 && ~isempty(videofile) && ~loaded)
+  fprintf(['decoding the video...\n']);
+  tic;
+  [Iall,led_good] = Load_Video_Stack(videofile,videolog,n1,n2,Litidx,illumination_na<NA);
+  Nimg = size(Iall,3);
+  Ibk = 50*ones(Nimg,1);
+  fprintf(['\nFinished decoding video\n']);
+  toc;
+end
+
+if loadimages == 1 && ~loaded
+  FP_Cache('put',key_load,struct('Iall',Iall,'Ibk',Ibk,'led_good',led_good));
+end
+
+% LED array position, rotation and distance from the brightfield spectra
+if estimate_geometry == 1 && numlit == 1
+  geo_roi = [n1/2-Np/2, n1/2+Np/2-1, n2/2-Np/2, n2/2+Np/2-1];  % same region as Imea
+  key_geo = FP_Cache('key','geometry',key_load,geo_roi,NA,lambda,du,ds_led,z_led,led_offset,led_rot,fp_version);
+  [cached,st] = FP_Cache('get',key_geo);
+  if cached
+    geo = st.geo;
+  else
+    geo = Estimate_LED_Geometry(Iall,geo_roi,hhled,vvled,Litidx(1:Nimg),led_good,ds_led,...
+      struct('led_offset',led_offset,'led_rot',led_rot,'z_led',z_led),NA,lambda,du);
+    FP_Cache('put',key_geo,struct('geo',geo));
+  end
+  clear st
+  led_offset = geo.led_offset;
+  led_rot = geo.led_rot;
+  z_led = geo.z_led;
+  [sin_thetav,sin_thetah,dd] = LED_Angles(hhled,vvled,ds_led,z_led,led_offset,led_rot);
+  illumination_na = sqrt(sin_thetav.^2+sin_thetah.^2);
+  illumination_na_used = illumination_na(LitCoord);
+  NBF = sum(illumination_na_used<NA);
+end
+
+% per-LED brightness and background profile from a blank-slide calibration sweep
+if runcalibration == 1
+  fprintf(['computing LED calibration profile...\n']);
+  calibfiles = dir([calib_dir,'*.tif']);
+  calibfiles = strcat(calib_dir,natsortfiles({calibfiles.name}));
+  calib_roi = [n1/2-Np/2, n1/2+Np/2-1, n2/2-Np/2, n2/2+Np/2-1];  % same region as Imea
+  key_calib = FP_Cache('key','calib',FP_Cache('files',calibfiles),calib_roi,Litidx,NA,ds_led,z_led,led_offset,led_rot,...
+    bracket_exposure(1:nbracket),sat_level,read_noise,fp_version);
+  [cached,st] = FP_Cache('get',key_calib);
+  if cached
+    led_scale = st.led_scale; led_bk = st.led_bk;
+  else
+    [led_scale,led_bk] = LED_Scale_Calibrate(calibfiles,illumination_na_used<NA,z_led./dd(LitCoord),calib_roi,...
+      struct('exposure',bracket_exposure(1:nbracket),'sat_level',sat_level,'read_noise',read_noise));  % the sweep is bracketed like the measurement
+    FP_Cache('put',key_calib,struct('led_scale',led_scale,'led_bk',led_bk));
+  end
+  clear st
+  scale_map = nan(size(LitCoord));  % stored on the panel grid so the profile survives dia_led/decimation changes
+  bk_map = nan(size(LitCoord));
+  scale_map(Litidx) = led_scale;
+  bk_map(Litidx) = led_bk;
+  save(calib_profile,'scale_map','bk_map','lit_cenv','lit_cenh');
+end
 
-idx_u = round(uled/du);  % spatial freq index for each plane wave relative to the center
-idx_v = round(vled/du);
+led_scale = ones(Nled,1);
+if exist(calib_profile,'file')
+  calib = load(calib_profile);
+  if any(isnan(calib.scale_map(Litidx))) || ~isequal([calib.lit_cenv,calib.lit_cenh],[lit_cenv,lit_cenh])
+    fprintf('LED profile does not cover the current LED layout, rerun the calibration. Using uniform scale\n');
+  else
+    fprintf(['using LED profile ',calib_profile,'\n']);
+    led_scale = calib.scale_map(Litidx);
+    Ibk = calib.bk_map(Litidx);
+  end
+  clear calib
+end
 
 um_p = max(illumination_na_used)/lambda+um_m;  % maxium spatial frequency achievable based on the maximum illumination angle from the LED array and NA of the objective
 dx0_p = 1/um_p/2;  % resolution achieved after freq post-processing
 disp(['synthetic NA is ',num2str(um_p*lambda)]);
 
 N_obj = round(2*um_p/du)*2; % assume the max spatial freq of the original object    um_obj>um_p    assume the # of pixels of the original object
-N_obj = ceil(N_obj/Np)*Np;   % need to enforce N_obj/Np = integer to ensure no FT artifacts
+N_obj = FFT_Size_Plan(N_obj,Np);   % smallest 2/3/5-smooth size with the parity of Np, the initial guess is zero-padded in the Fourier domain so N_obj/Np need not be an integer
 um_obj = du*N_obj/2;  % max spatial freq of the original object
 dx_obj = 1/um_obj/2;   % sampling size of the object (=pixel size of the test image)
 [xp,yp] = meshgrid([-Np/2:Np/2-1]*dpix_m);
@@ -177,149 +338,280 @@ H0 = exp(1i*2*pi/lambda*z0)*exp(-1i*pi*lambda*z0*(u.^2+v.^2));
 % OR angular spectrum
 % H0 = exp(1i*2*pi*sqrt((1/lambda^2-u.^2-v.^2).*double(sqrt(u.^2+v.^2)<1/lambda))*dz);
 
-Imea = double(Iall(n1/2 - Np/2 : n1/2 + Np/2 - 1 ,n2/2 - Np/2 : n2/2 + Np/2 - 1,:)); %Use only a portion of the input images
+% FFT threads, planner and precision for this machine and problem size
+if ~isempty(autotune_file) && (autotune == 1 || exist(autotune_file,'file'))
+  tuned = FP_Autotune(Np,N_obj,Nimg,autotune_file,autotune);
+  fft_threads = tuned.fft_threads;
+  precision = tuned.precision;
+end
+
+% sample drift over the acquisition sequence, from the central region of every frame
+drift = zeros(Nimg,2);
+if registerdrift == 1
+  droi = [n1/2-drift_roi/2, n1/2+drift_roi/2-1, n2/2-drift_roi/2, n2/2+drift_roi/2-1];
+  key_drift = FP_Cache('key','drift',key_load,droi,illumination_na_used(1:Nimg)<NA,fp_version);
+  [cached,st] = FP_Cache('get',key_drift);
+  if cached
+    drift = st.drift;
+  else
+    drift = Register_Drift(Iall,illumination_na_used(1:Nimg)<NA,droi);
+    FP_Cache('put',key_drift,struct('drift',drift));
+  end
+  clear st
+end
+
+% tiles reconstructed from the frame center outward, each one warm-started from its converged neighbours
+if tiles == 1
+  tcen = Tile_Schedule(n1,n2,Np,tile_overlap);
+else
+  tcen = [n1/2,n2/2];
+end
+ntile = size(tcen,1);
+tileP = cell(ntile,1);
+tileScale = [];
+tileDNs = [];
+tilefiles = cell(ntile,1);
+
+for t = 1:ntile
+  tr = tcen(t,1); tc = tcen(t,2);
+  fprintf('tile %d of %d, center (%d,%d)\n',t,ntile,tr,tc);
+  % illumination angles seen from the tile center, off-axis tiles see the LEDs at shifted angles
+  yt = (tr-n1/2)*dpix_m;
+  xt = (tc-n2/2)*dpix_m;
+  [sin_tv,sin_th] = LED_Angles(hhled,vvled,ds_led,z_led,led_offset,led_rot,[yt,xt]);
+  idx_v = round(sin_tv/lambda/du);
+  idx_u = round(sin_th/lambda/du);
+
+  ledidx = 1:Nled;
+  ledidx = reshape(ledidx,numlit,Nimg);
+  lit = Litidx(ledidx);
+  lit = reshape(lit,numlit,Nimg);
+
+  [dis_lit2,idx_led] = sort(reshape(illumination_na_used,1,Nled));  % reorder LED indices based on illumination NA
+
+  Nsh_lit = zeros(numlit,Nimg);
+  Nsv_lit = zeros(numlit,Nimg);
+
+  for m = 1:Nimg
+      lit0 = lit(:,m);   % corresponding index of spatial freq for the LEDs are lit
+      Nsh_lit(:,m) = idx_u(lit0);
+      Nsv_lit(:,m) = idx_v(lit0);
+  end
+
+  Ns = [];
+  Ns(:,:,1) = Nsv_lit;   % reorder the LED indices and intensity measurements according the previous
+  Ns(:,:,2) = Nsh_lit;
+
+  Ns_reorder = Ns(:,idx_led,:);
+
+  Nused = size(Iall(1,1,:))(3);
+
+  idx_used = find(led_good(idx_led)).';  % LEDs without a usable frame are left out
+
+  % Use only a portion of the input images, shifted to follow the sample drift,
+  % in NA order. Kept as uint16, each frame quantized over its own range,
+  % AlterMin converts one frame at a time and Iscale restores the counts
+  I = zeros(Np,Np,numel(idx_used),'uint16');
+  Iscale = ones(1,numel(idx_used));
+  for k = 1:numel(idx_used)
+      m = idx_led(idx_used(k));
+      Itmp = Shift_Crop(Iall(:,:,m),[tr,tc],Np,drift(m,:));
+      % pre-processing the data to DENOISING is IMPORTANT
+      % background subtraction
+      Itmp = Itmp-Ibk(m);
+  %     Itmp = awgn(Itmp,0,'measured');
+      Itmp(Itmp<0) = 0;
+      Iscale(k) = max(Itmp(:))/65535;  % full 16-bit range for every frame, dim darkfield keeps its fractional counts
+      if Iscale(k) == 0
+        Iscale(k) = 1;
+      end
+      I(:,:,k) = uint16(Itmp/Iscale(k));
+  end
+  clear Itmp
+  Ns2 = Ns_reorder(:,idx_used,:);
+
+  % warm start from the converged neighbours
+  dNs = zeros(numel(idx_used),2);
+  if t > 1
+    [P0,scale0,dNs] = Tile_Seed(tcen(t,:),tcen(1:t-1,:),tileP,tileScale,tileDNs,tile_seed);
+  end
+  % shift corrections only exist when AlterMin calibrates the LED positions
+  Ns_t = round(Ns2);
+  if ~isequal(pos_calibrate,0)
+    Ns_t = Ns_t+reshape(dNs,size(Ns2));
+  end
 
-ledidx = 1:Nled;
-ledidx = reshape(ledidx,numlit,Nimg);
-lit = Litidx(ledidx);
-lit = reshape(lit,numlit,Nimg);
+  %% reconstruction algorithm options: opts
+  %   tol: maximum change of error allowed in two consecutive iterations
+      %   maxIter: maximum iterations
+      %   minIter: minimum iterations
+      %   monotone (1, default): if monotone, error has to monotonically dropping
+      %   when iters>minIter
+  %   display: display results (0: no (default) 1: yes)
+      %   saveIterResult: save results at each step as images (0: no (default) 1: yes)
+      %   mode: display in 'real' space or 'fourier' space.
+      %   out_dir: saving directory
+  %   O0, P0: initial guesses for O and P
+      %   OP_alpha: regularization parameter for O
+      %   OP_beta: regularization parameter for P
+  %   scale: LED brightness map
+  %   scaleUpdate: re-estimate the LED brightness from I_est and I_mea every pass
+  %   H0: known portion of the aberration function,
+          % e.g. sample with a known defocus induce a quardratic aberration
+          % function can be defined here
+  %   poscalibrate: flag for LED position correction using
+      % '0': no correction
+      % 'sa': simulated annealing method
+          % calbratetol: parameter in controlling error tolence in sa
+      % 'ga': genetic algorithm
+      % caution: takes consierably much longer time to compute a single iteration
+  %   F, Ft: operators of Fourier transform and inverse
+  %   fft_threads: FFTW threads used inside each 2-D transform
+  %   precision: 'double' or 'single' arithmetic
+  %   Iscale: per-frame factor from the uint16 values of I to intensity
+  opts.tol = 1;
+  opts.maxIter = 10;
+  opts.minIter = 2;
+  opts.monotone = 1;
+  % 'full', display every subroutin,
+  % 'iter', display only results from outer loop
+  % 0, no display
+  opts.display = recon_display;%'full';%0;%'iter';
+  upsamp = @(x) padarray(x,[(N_obj-Np)/2,(N_obj-Np)/2]);
+  if dpc_init == 1
+    opts.O0 = DPC_Init(I,Ns_t,w_NA,[N_obj,N_obj],F,Ft,1e-1,Iscale);
+  else
+    opts.O0 = F(sqrt(double(I(:,:,1))*Iscale(1)));
+    opts.O0 = upsamp(opts.O0);
+  end
+  opts.P0 = w_NA;
+  opts.Ps = w_NA;
+  opts.iters = 1;
+  opts.mode = 'fourier';
+  opts.scale = led_scale(idx_led);
+  opts.scale = opts.scale(idx_used);
+  opts.scaleUpdate = scale_update;
+  opts.OP_alpha = 1;
+  opts.OP_beta = 1e3 ;
+  opts.poscalibrate = pos_calibrate;
+  opts.calbratetol = 1e-1;
+  opts.F = F;
+  opts.Ft = Ft;
+  opts.StepSize = 0.1;
+  opts.fft_threads = fft_threads;
+  opts.precision = precision;
+  opts.Iscale = Iscale;
+  opts.schedule = frame_schedule;
+  if t > 1
+    opts.P0 = P0;
+    opts.scale = scale0;
+  end
 
-[dis_lit2,idx_led] = sort(reshape(illumination_na_used,1,Nled));  % reorder LED indices based on illumination NA
+  %% algorithm starts
+  %testc = evalc("[O,P,err_pc,c,Ns_cal] = AlterMin(I,[N_obj,N_obj],Ns_t,opts);")
 
-Nsh_lit = zeros(numlit,Nimg);
-Nsv_lit = zeros(numlit,Nimg);
+  diary tempdiary
 
-for m = 1:Nimg
-    lit0 = lit(:,m);   % corresponding index of spatial freq for the LEDs are lit
-    Nsh_lit(:,m) = idx_u(lit0);
-    Nsv_lit(:,m) = idx_v(lit0);
-end
+  refine_file = refine_result;
+  if ntile > 1 && ~isempty(refine_result)
+    refine_file = regexprep(refine_result,'(-tile\d+)?(\.mat)?$',sprintf('-tile%02d$2',t));  % keeps the extension, if any
+  end
 
-Ns = [];
-Ns(:,:,1) = Nsv_lit;   % reorder the LED indices and intensity measurements according the previous
-Ns(:,:,2) = Nsh_lit;
-
-Imea_reorder = Imea(:,:,idx_led);
-Ibk_reorder = Ibk(idx_led);
-
-% pre-processing the data to DENOISING is IMPORTANT
-% background subtraction
-Ithresh_reorder = Imea_reorder;
-for m = 1:Nimg
-    Itmp = Ithresh_reorder(:,:,m);
-    Itmp = Itmp-Ibk_reorder(m);
-%     Itmp = awgn(Itmp,0,'measured');
-    Itmp(Itmp<0) = 0;
-    Ithresh_reorder(:,:,m) = Itmp;
-end
+  % display and thread settings do not change the result and are left out of the key
+  key_recon = FP_Cache('key','recon',key_load,drift,[tr,tc],Ibk,led_good,N_obj,Ns_t,dpc_init,...
+    rmfield(opts,{'O0','display','fft_threads'}),refine_frames,FP_Cache('files',refine_file),fp_version);
+  [cached,st] = FP_Cache('get',key_recon);
+  if cached
+    O = st.O; P = st.P; err_pc = st.err_pc; c = st.c; Ns_cal = st.Ns_cal;
+    fprintf('reconstruction loaded from cache\n');
+  elseif isempty(refine_frames)
+    [O,P,err_pc,c,Ns_cal] = AlterMin(I,[N_obj,N_obj],Ns_t,opts);
+  else
+    prev = load(refine_file);
+    [~,replaced] = ismember(refine_frames,idx_led(idx_used));  % position of each reacquired frame in I
+    [O,P,err_pc,c,Ns_cal] = AlterMin_Refine(I,prev,replaced(replaced>0),opts);
+    clear prev
+  end
+  if ~cached
+    FP_Cache('put',key_recon,struct('O',O,'P',P,'err_pc',err_pc,'c',c,'Ns_cal',Ns_cal));
+  end
+  clear st
+
+  tileP{t} = P;
+  tileScale(:,t) = c(:);
+  tileDNs(:,:,t) = reshape(Ns_cal-round(Ns2),[],2);
+
+  diary off
+  diaryfid = fopen("tempdiary");
+  diarytext = fscanf(diaryfid,"%c");
+  fclose(diaryfid);
+  delete tempdiary;
+
+
+  %% save results
+  fn = ['RandLit-',num2str(numlit),'-',num2str(Nused)];
+  if ntile > 1
+    fn = sprintf('%s-tile%02d',fn,t);
+  end
+  save('-binary',[out_dir,'\',fn],'O','P','err_pc','c','Ns_cal');  % binary, Tile_Blend and refinement load these back
+  tilefiles{t} = [out_dir,'\',fn];
+
+  %f1 = figure; imagesc(-angle(O),[-.6,1]); axis image; colormap gray; axis off
+
+  fprintf('processing complete\n');
+
+  %I = mat2gray(real(O));
+  %figure(2);imshow(I);
 
-Ns_reorder = Ns(:,idx_led,:);
-clear Imea;
-
-Nused = size(Iall(1,1,:))(3);
-
-idx_used = 1:Nused;
-I = Ithresh_reorder(:,:,idx_used);
-Ns2 = Ns_reorder(:,idx_used,:);
-
-%% reconstruction algorithm options: opts
-%   tol: maximum change of error allowed in two consecutive iterations
-    %   maxIter: maximum iterations
-    %   minIter: minimum iterations
-    %   monotone (1, default): if monotone, error has to monotonically dropping
-    %   when iters>minIter
-%   display: display results (0: no (default) 1: yes)
-    %   saveIterResult: save results at each step as images (0: no (default) 1: yes)
-    %   mode: display in 'real' space or 'fourier' space.
-    %   out_dir: saving directory
-%   O0, P0: initial guesses for O and P
-    %   OP_alpha: regularization parameter for O
-    %   OP_beta: regularization parameter for P
-%   scale: LED brightness map
-%   H0: known portion of the aberration function,
-        % e.g. sample with a known defocus induce a quardratic aberration
-        % function can be defined here
-%   poscalibrate: flag for LED position correction using
-    % '0': no correction
-    % 'sa': simulated annealing method
-        % calbratetol: parameter in controlling error tolence in sa
-    % 'ga': genetic algorithm
-    % caution: takes consierably much longer time to compute a single iteration
-%   F, Ft: operators of Fourier transform and inverse
-opts.tol = 1;
-opts.maxIter = 10;
-opts.minIter = 2;
-opts.monotone = 1;
-% 'full', display every subroutin,
-% 'iter', display only results from outer loop
-% 0, no display
-opts.display = 'full';%0;%'iter';
-upsamp = @(x) padarray(x,[(N_obj-Np)/2,(N_obj-Np)/2]);
-opts.O0 = F(sqrt(I(:,:,1)));
-opts.O0 = upsamp(opts.O0);
-opts.P0 = w_NA;
-opts.Ps = w_NA;
-opts.iters = 1;
-opts.mode = 'fourier';
-opts.scale = ones(Nused,1);
-opts.OP_alpha = 1;
-opts.OP_beta = 1e3 ;
-opts.poscalibrate =0;
-opts.calbratetol = 1e-1;
-opts.F = F;
-opts.Ft = Ft;
-opts.StepSize = 0.1;
-
-%% algorithm starts
-%testc = evalc("[O,P,err_pc,c,Ns_cal] = AlterMin(I,[N_obj,N_obj],round(Ns2),opts);")
-
-diary tempdiary
-
-[O,P,err_pc,c,Ns_cal] = AlterMin(I,[N_obj,N_obj],round(Ns2),opts);
-
-diary off
-diaryfid = fopen("tempdiary");
-diarytext = fscanf(diaryfid,"%c");
-fclose(diaryfid);
-delete tempdiary;
-
-
-%% save results
-fn = ['RandLit-',num2str(numlit),'-',num2str(Nused)];
-save([out_dir,'\',fn],'O','P','err_pc','c','Ns_cal');
-
-%f1 = figure; imagesc(-angle(O),[-.6,1]); axis image; colormap gray; axis off
-
-fprintf('processing complete\n');
-
-%I = mat2gray(real(O));
-%figure(2);imshow(I);
-
-%figure(2);imshow(angle(O),[]);
-figure(1);imshow(abs(O),[])
-% figure(3);imagesc(-angle(O));colormap gray;
-filenamebase = datestr(now(), 'yyyy-mm-dd_HH-MM-SS');
-
-
-scalefactor = 65536 / max(max(abs(O)));
-imwrite(uint16(abs(O).*scalefactor), strcat(out_dir, "/", filenamebase, ".tif"));
-
-fidtxt = fopen(strcat(out_dir, "/", filenamebase, ".txt"), 'w');
-fprintf(fidtxt, "%s = %d\n", 'n1', n1);
-fprintf(fidtxt, "%s = %d\n", 'n2', n2);
-fprintf(fidtxt, "%s = %d\n", 'lambda', lambda);
-fprintf(fidtxt, "%s = %d\n", 'NA', NA);
-fprintf(fidtxt, "%s = %d\n", 'mag', mag);
-fprintf(fidtxt, "%s = %d\n", 'dpix_c', dpix_c);
-fprintf(fidtxt, "%s = %d\n", 'Np', Np);
-fprintf(fidtxt, "%s = %d\n", 'ds_led', ds_led);
-fprintf(fidtxt, "%s = %d\n", 'decimation_led', decimation_led);
-fprintf(fidtxt, "%s = %d\n", 'z_led', z_led);
-fprintf(fidtxt, "%s = %d\n", 'dia_led', dia_led);
-fprintf(fidtxt, "%s = %d\n", 'lit_cenv', lit_cenv);
-fprintf(fidtxt, "%s = %d\n", 'lit_cenh', lit_cenh);
-fprintf(fidtxt, "%s = %d\n", 'Nled', Nled);
-fprintf(fidtxt, "%s = %s\n", 'Synthetic NA', num2str(um_p*lambda));
-fprintf(fidtxt, "\n%s\n", 'Synthetic NA', diarytext);
-fclose(fidtxt);
+  %figure(2);imshow(angle(O),[]);
+  if ~isequal(recon_display,0)
+    figure(1);imshow(abs(O),[])
+  end
+  % figure(3);imagesc(-angle(O));colormap gray;
+  filenamebase = datestr(now(), 'yyyy-mm-dd_HH-MM-SS');
+  if ntile > 1
+    filenamebase = sprintf('%s_tile%02d',filenamebase,t);
+  end
+
+
+  scalefactor = 65536 / max(max(abs(O)));
+  imwrite(uint16(abs(O).*scalefactor), strcat(out_dir, "/", filenamebase, ".tif"));
+  if unwrap_phase > 0 && ntile == 1
+    Unwrap_Phase_LS(O,struct('weighted',unwrap_phase==2,'fft_threads',fft_threads,...
+      'outfile',strcat(out_dir, "/", filenamebase, "_phase.raw")));
+  end
 
+  fidtxt = fopen(strcat(out_dir, "/", filenamebase, ".txt"), 'w');
+  fprintf(fidtxt, "%s = %d\n", 'n1', n1);
+  fprintf(fidtxt, "%s = %d\n", 'n2', n2);
+  fprintf(fidtxt, "%s = %d\n", 'lambda', lambda);
+  fprintf(fidtxt, "%s = %d\n", 'NA', NA);
+  fprintf(fidtxt, "%s = %d\n", 'mag', mag);
+  fprintf(fidtxt, "%s = %d\n", 'dpix_c', dpix_c);
+  fprintf(fidtxt, "%s = %d\n", 'Np', Np);
+  fprintf(fidtxt, "%s = %d\n", 'ds_led', ds_led);
+  fprintf(fidtxt, "%s = %d\n", 'decimation_led', decimation_led);
+  fprintf(fidtxt, "%s = %d\n", 'z_led', z_led);
+  fprintf(fidtxt, "%s = %d\n", 'dia_led', dia_led);
+  fprintf(fidtxt, "%s = %d\n", 'lit_cenv', lit_cenv);
+  fprintf(fidtxt, "%s = %d\n", 'lit_cenh', lit_cenh);
+  fprintf(fidtxt, "%s = %s\n", 'led_offset', num2str(led_offset));
+  fprintf(fidtxt, "%s = %d\n", 'led_rot', led_rot);
+  fprintf(fidtxt, "%s = %d\n", 'Nled', Nled);
+  fprintf(fidtxt, "%s = %d,%d\n", 'tile center', tr, tc);
+  fprintf(fidtxt, "%s = %s\n", 'Synthetic NA', num2str(um_p*lambda));
+  fprintf(fidtxt, "%s = %d x %d\n", 'object size', size(O,1), size(O,2));
+  fprintf(fidtxt, "\n%s\n", 'Synthetic NA', diarytext);
+  fclose(fidtxt);
+end
+
+% one seamless complex mosaic from all tiles, written as raw interleaved float32 (re,im) row by row
+if ntile > 1
+  mosaicfile = strcat(out_dir, "/", datestr(now(), 'yyyy-mm-dd_HH-MM-SS'), "_mosaic.raw");
+  mosaic_size = Tile_Blend(tilefiles,tcen,Np,tile_overlap,mosaicfile);
+  if unwrap_phase > 0
+    Unwrap_Phase_LS(mosaicfile,struct('weighted',unwrap_phase==2,'fft_threads',fft_threads,...
+      'size',mosaic_size,'tile',unwrap_tile,'overlap',round(tile_overlap*N_obj/Np),...
+      'outfile',strrep(mosaicfile,'_mosaic.raw','_mosaic_phase.raw')));
+  end
+end